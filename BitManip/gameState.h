@@ -55,14 +55,24 @@ void initializeGameState(GameState* state) {
     state->reserve = (static_cast<uint8_t>(deck[50]) & 0x0F) | ((static_cast<uint8_t>(deck[51]) & 0x0F) << 4);
 }
 
+// helper to rotate a 32 bit word left. _rotl is MSVC only, GCC and Clang turn the shifts into one rotate instruction
+inline uint32_t rotl32(uint32_t value, int shift) {
+#ifdef _MSC_VER
+    return _rotl(value, shift);
+#else
+    shift &= 31;
+    return (value << shift) | (value >> ((32 - shift) & 31));
+#endif
+}
+
 // Hasher for GameState
 struct GameStateHasher {
     size_t operator()(const GameState& state) const {
         size_t hash = 0;
         for (int i = 0; i < 10; ++i) {
-            hash ^= _rotl(state.piles[i], i % 32);
+            hash ^= rotl32(state.piles[i], i % 32);
         }
-        hash ^= _rotl(state.reserve, 10); // Rotate reserve by a fixed amount
+        hash ^= rotl32(state.reserve, 10); // Rotate reserve by a fixed amount
         return hash;
     }
 };
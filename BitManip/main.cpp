@@ -7,8 +7,6 @@ Color and suit do not matter. Only the top cards of each stack are in play.
  // See game state to understand how this is different.
  // Without multithreading, it can do 5000 games in about 7 seconds.
 
-#pragma once
-
 #include <iostream>
 #include <iomanip>
 #include <array>
@@ -11,7 +11,6 @@ const bool DEBUG = false;
 const bool ADVANCEDEBUG = false;
 // numSims is 5000 in conventional benchmarking
 const int numSimulations = 100;
-#pragma once
 #include <iostream>
 #include <algorithm>
 #include <random>
@@ -24,7 +23,8 @@ const int numSimulations = 100;
 #include <thread>
 #include <mutex>
 #include <array>
-#include <immintrin.h>
+#include <cstring>
+#include <cstdint>
 
 using namespace std;
 
@@ -67,11 +67,21 @@ struct CompactGameState {
     }
 };
 
+// helper to rotate a 32 bit word left. _rotl is MSVC only, GCC and Clang turn the shifts into one rotate instruction
+inline uint32_t rotl32(uint32_t value, int shift) {
+#ifdef _MSC_VER
+    return _rotl(value, shift);
+#else
+    shift &= 31;
+    return (value << shift) | (value >> ((32 - shift) & 31));
+#endif
+}
+
 struct CompactGameStateHasher {
     size_t operator()(const CompactGameState& state) const {
         size_t hash = 0;
         for (int i = 0; i < NUM_PILES * PILE_SIZE + RESERVE_SIZE; ++i) {
-            hash ^= _rotl(state.state[i], i % 32);
+            hash ^= rotl32(static_cast<uint32_t>(state.state[i]), i % 32);
         }
         return hash;
     }
@@ -246,8 +246,8 @@ void simulateGames(int numSimsThisThread, int offset, int& unsolvableCount, mute
     
     if (BENCHMARKING) {
         for (int i = 0; i < numSimsThisThread; ++i) {
-            if (DEBUG) {cout << "Simulation " << offset + i << "begins (On thread: " << this_thread::get_id() << ")" << endl;
-            auto start = chrono::steady_clock::now(); }
+            if (DEBUG) cout << "Simulation " << offset + i << "begins (On thread: " << this_thread::get_id() << ")" << endl;
+            auto start = chrono::steady_clock::now();
 
             if (!isSolvable(decks[offset + i])) {
                 lock_guard<mutex> lock(mtx);
@@ -257,8 +257,8 @@ void simulateGames(int numSimsThisThread, int offset, int& unsolvableCount, mute
 
             if (DEBUG) {
                 auto end = chrono::steady_clock::now();
-                //auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-                //cout << "Simulation " << offset + i << " took " << duration.count() << " milliseconds. On thread " << this_thread::get_id() << endl;
+                auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+                cout << "Simulation " << offset + i << " took " << duration.count() << " milliseconds. On thread " << this_thread::get_id() << endl;
                 cout << "Unsolvable count: " << unsolvableCount << endl;
             }
         }
@@ -0,0 +1,124 @@
+#pragma once
+
+/* Adaptive Monte Carlo stopping. Instead of a fixed number of games, the run takes a target precision for the
+  unsolvable percentage (e.g. +-0.01 percentage points at 99% confidence) and keeps solving random deals until the
+  Wilson score interval on the unsolvable fraction is at least that narrow.
+  Threads solve deals in chunks and only add a finished chunk to the shared totals, checking the interval each time,
+  so when one thread sees the target reached every thread stops after its current chunk and all counted deals were fully solved.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "solver.h"
+
+// a two sided confidence interval on a fraction
+struct WilsonInterval {
+    double low;
+    double high;
+};
+
+// Wilson score interval for `hits` out of `trials` with normal quantile z
+WilsonInterval wilsonInterval(uint64_t hits, uint64_t trials, double z) {
+    if (trials == 0) return WilsonInterval{ 0.0, 1.0 };
+    double n = (double)trials;
+    double p = (double)hits / n;
+    double z2 = z * z;
+    double centre = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double halfWidth = z * sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+    return WilsonInterval{ centre - halfWidth, centre + halfWidth };
+}
+
+// the two sided normal quantile for a confidence level, e.g. 0.99 -> 2.5758. Bisection on erfc, it only runs once
+double zForConfidence(double confidence) {
+    double low = 0.0, high = 10.0;
+    for (int i = 0; i < 100; ++i) {
+        double mid = (low + high) / 2;
+        // erfc(z / sqrt 2) is the two sided tail probability of z
+        if (erfc(mid / sqrt(2.0)) > 1 - confidence) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (low + high) / 2;
+}
+
+// totals shared by the threads of an adaptive run
+struct AdaptiveRun {
+    mutex mtx;
+    uint64_t games;
+    uint64_t unsolvable;
+    double z;
+    double targetHalfWidth; // as a fraction, not percentage points
+    atomic<bool> done;
+};
+
+// deals each thread solves between two looks at the shared totals
+const int ADAPTIVE_CHUNK = 4096;
+
+/* function which runs on a thread, solving random deals a chunk at a time until the interval is narrow enough
+(or maxGames deals have been counted, 0 for no limit)
+*/
+void simulateGamesAdaptive(AdaptiveRun& run, uint64_t maxGames) {
+    while (!run.done.load(std::memory_order_relaxed)) {
+        uint64_t unsolvable = 0;
+        for (int i = 0; i < ADAPTIVE_CHUNK; ++i) {
+            GameState active;
+            initializeGameState(&active);
+            if (!isSolvable(&active)) {
+                unsolvable++;
+            }
+        }
+        lock_guard<mutex> lock(run.mtx);
+        if (run.done.load(std::memory_order_relaxed)) return;
+        uint64_t before = run.games;
+        run.games += ADAPTIVE_CHUNK;
+        run.unsolvable += unsolvable;
+        WilsonInterval interval = wilsonInterval(run.unsolvable, run.games, run.z);
+        if ((interval.high - interval.low) / 2 <= run.targetHalfWidth || (maxGames && run.games >= maxGames)) {
+            run.done.store(true, std::memory_order_relaxed);
+        }
+        if (run.games / 1000000 != before / 1000000) {
+            cout << "Games: " << run.games / 1000000 << " million, unsolvable " << 100 * (double)run.unsolvable / run.games
+                << "% +- " << 50 * (interval.high - interval.low) << " points" << endl;
+        }
+    }
+}
+
+/* runs random deals on numThreads threads until the Wilson interval's half width is at most targetPoints percentage points
+at the given confidence level, then prints the interval
+*/
+void runAdaptive(int numThreads, double targetPoints, double confidence, uint64_t maxGames) {
+    AdaptiveRun run;
+    run.games = 0;
+    run.unsolvable = 0;
+    run.z = zForConfidence(confidence);
+    run.targetHalfWidth = targetPoints / 100;
+    run.done = false;
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(simulateGamesAdaptive, ref(run), maxGames);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+    WilsonInterval interval = wilsonInterval(run.unsolvable, run.games, run.z);
+    cout << "Games solved: " << run.games << endl;
+    cout << "Unsolvable count: " << run.unsolvable << endl;
+    cout << "Unsolvable percentage: " << 100 * (double)run.unsolvable / run.games << "%" << endl;
+    cout << 100 * confidence << "% Wilson interval: [" << 100 * interval.low << "%, " << 100 * interval.high << "%] (+- "
+        << 50 * (interval.high - interval.low) << " points)" << endl;
+    if ((interval.high - interval.low) / 2 > run.targetHalfWidth) {
+        cout << "Stopped at the game limit before reaching the target of +- " << targetPoints << " points." << endl;
+    }
+    cout << "Total time: " << duration.count() << " milliseconds." << endl;
+}
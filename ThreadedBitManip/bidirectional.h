@@ -0,0 +1,152 @@
+#pragma once
+
+/* Bidirectional search. For a fixed deal a state is just how many cards are gone from each pile and the reserve
+  (see stateKey()), so there is exactly one goal state, everything gone, and moves can be run backwards: putting back
+  the next card of two piles (or a pile and the reserve) is the reverse of a legal move if those two cards pair.
+  Every move takes two cards, so a state with c cards gone can only be reached in c / 2 moves and states never repeat
+  across layers. The search keeps one layer from each end, forward from the deal and backward from the goal, always
+  expanding the smaller one, until they reach the same number of cards: the deal is solvable exactly if the two
+  layers share a state. If either side runs out of states first, no path can get through that layer.
+  Layers are sorted vectors of stateKey() keys, deduplicated with sort and unique. For unsolvable deals the backward
+  side usually dies out after a few layers, long before the forward side has been explored. Solvable deals are the
+  other way round, solve() stops at its first solution while the layers here are always expanded whole, so this suits
+  the deep unsolvable deals best (the playouts in playout.h take a lot of the easy solvable ones off it).
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "solver.h"
+
+// a deal as cards by depth, and the stateKey() weight of each pile and the reserve
+struct DealLayout {
+    int pileCards[NUM_PILES][PILE_SIZE];  // [pile][depth], depth 0 is the top card
+    int reserveCards[RESERVE_SIZE];
+    uint32_t weights[NUM_PILES];
+    uint32_t reserveWeight;
+};
+
+void initDealLayout(DealLayout& layout, const GameState& deal) {
+    uint32_t weight = 1;
+    for (int i = NUM_PILES - 1; i >= 0; --i) {
+        for (int d = 0; d < PILE_SIZE; ++d) {
+            layout.pileCards[i][d] = (deal.piles[i] >> (4 * d)) & 0x0F;
+        }
+        layout.weights[i] = weight;
+        weight *= PILE_SIZE + 1;
+    }
+    for (int d = 0; d < RESERVE_SIZE; ++d) {
+        layout.reserveCards[d] = (deal.reserve >> (4 * d)) & 0x0F;
+    }
+    layout.reserveWeight = weight;
+}
+
+// helper to split a key into the cards gone from each pile and from the reserve
+inline void keyDepths(uint32_t key, int removed[NUM_PILES], int& reserveRemoved) {
+    for (int i = NUM_PILES - 1; i >= 0; --i) {
+        removed[i] = key % (PILE_SIZE + 1);
+        key /= PILE_SIZE + 1;
+    }
+    reserveRemoved = static_cast<int>(key);
+}
+
+// appends the states one move on from key
+void expandForward(const DealLayout& layout, uint32_t key, vector<uint32_t>& next) {
+    int removed[NUM_PILES], reserveRemoved;
+    keyDepths(key, removed, reserveRemoved);
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (removed[i] == PILE_SIZE) continue;
+        int card1 = layout.pileCards[i][removed[i]];
+        for (int j = i + 1; j < NUM_PILES; ++j) {
+            if (removed[j] != PILE_SIZE && isPair(card1, layout.pileCards[j][removed[j]])) {
+                next.push_back(key + layout.weights[i] + layout.weights[j]);
+            }
+        }
+        if (reserveRemoved < RESERVE_SIZE && isPair(layout.reserveCards[reserveRemoved], card1)) {
+            next.push_back(key + layout.weights[i] + layout.reserveWeight);
+        }
+    }
+}
+
+// appends the states one move back from key: the ones that key can be reached from
+void expandBackward(const DealLayout& layout, uint32_t key, vector<uint32_t>& next) {
+    int removed[NUM_PILES], reserveRemoved;
+    keyDepths(key, removed, reserveRemoved);
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (removed[i] == 0) continue;
+        int card1 = layout.pileCards[i][removed[i] - 1];
+        for (int j = i + 1; j < NUM_PILES; ++j) {
+            if (removed[j] != 0 && isPair(card1, layout.pileCards[j][removed[j] - 1])) {
+                next.push_back(key - layout.weights[i] - layout.weights[j]);
+            }
+        }
+        if (reserveRemoved > 0 && isPair(layout.reserveCards[reserveRemoved - 1], card1)) {
+            next.push_back(key - layout.weights[i] - layout.reserveWeight);
+        }
+    }
+}
+
+// helper to expand a whole layer one step in either direction, leaving the next layer sorted and deduplicated in layer
+void expandLayer(const DealLayout& layout, vector<uint32_t>& layer, vector<uint32_t>& scratch, bool forward) {
+    scratch.clear();
+    for (uint32_t key : layer) {
+        if (forward) {
+            expandForward(layout, key, scratch);
+        } else {
+            expandBackward(layout, key, scratch);
+        }
+    }
+    sort(scratch.begin(), scratch.end());
+    scratch.erase(unique(scratch.begin(), scratch.end()), scratch.end());
+    layer.swap(scratch);
+}
+
+/* returns true if the deal can be cleared. statesVisited (if given) gets the number of distinct states in all layers
+  of both sides, the equivalent of solve()'s visited set size */
+bool solveBidirectional(const GameState& deal, uint64_t* statesVisited = nullptr) {
+    DealLayout layout;
+    initDealLayout(layout, deal);
+    const int totalCards = NUM_PILES * PILE_SIZE + RESERVE_SIZE;
+    vector<uint32_t> forward(1, stateKey(deal));
+    vector<uint32_t> backward(1, layout.reserveWeight * (RESERVE_SIZE + 1) - 1);
+    vector<uint32_t> scratch;
+    int forwardGone = 0, backwardGone = totalCards;
+    uint64_t visited = 2;
+    while (forwardGone < backwardGone && !forward.empty() && !backward.empty()) {
+        if (forward.size() <= backward.size()) {
+            expandLayer(layout, forward, scratch, true);
+            forwardGone += 2;
+            visited += forward.size();
+        } else {
+            expandLayer(layout, backward, scratch, false);
+            backwardGone -= 2;
+            visited += backward.size();
+        }
+    }
+    bool meet = false;
+    if (forwardGone == backwardGone) {
+        // both layers are sorted, look for a common key
+        size_t f = 0, b = 0;
+        while (f < forward.size() && b < backward.size() && !meet) {
+            if (forward[f] < backward[b]) {
+                f++;
+            } else if (backward[b] < forward[f]) {
+                b++;
+            } else {
+                meet = true;
+            }
+        }
+    }
+    if (statesVisited) *statesVisited = visited;
+    return meet;
+}
+
+// function which checks to see if a state is solvable with the bidirectional search
+bool isSolvableBidirectional(GameState* state, uint64_t* statesVisited = nullptr) {
+    if (hasThreeJacks(state)) {
+        if (statesVisited) *statesVisited = 0;
+        return false;
+    }
+    return solveBidirectional(*state, statesVisited);
+}
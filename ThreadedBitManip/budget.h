@@ -0,0 +1,85 @@
+#pragma once
+
+/* Per-deal budgets with an escalation tier. A handful of deals in every run take far longer than the rest,
+  and with deals split statically between threads one of those holds up its whole thread.
+  On the first pass every deal gets a budget in expanded nodes and/or microseconds. A deal that runs out is
+  abandoned and parked in an overflow queue. Once the first pass is done the parked deals are solved
+  without any budget by the escalation tier, which uses every thread on one deal and a bigger visited table,
+  so the final counts are still exact.
+*/
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "solver.h"
+#include "parallelSolver.h"
+
+enum BudgetResult { UNSOLVABLE, SOLVABLE, OVER_BUDGET };
+
+// how much a single deal may use on the first pass. 0 means no limit
+struct SearchBudget {
+    uint64_t maxNodes;
+    int64_t maxMicros;
+    uint64_t nodes;
+    chrono::steady_clock::time_point deadline;
+    bool exceeded;
+};
+
+// how many expanded nodes between two looks at the clock, reading it at every node would cost more than the search
+const uint64_t BUDGET_CLOCK_INTERVAL = 1024;
+
+// the probe that makes solve() give up (and set exceeded) once the budget is spent
+struct BudgetProbe : NoProbe {
+    SearchBudget& budget;
+
+    explicit BudgetProbe(SearchBudget& budget) : budget(budget) {}
+
+    bool expand() {
+        budget.nodes++;
+        if (budget.maxNodes && budget.nodes > budget.maxNodes) {
+            budget.exceeded = true;
+        } else if (budget.maxMicros && budget.nodes % BUDGET_CLOCK_INTERVAL == 0 && chrono::steady_clock::now() > budget.deadline) {
+            budget.exceeded = true;
+        }
+        return !budget.exceeded;
+    }
+    bool stopped() {
+        return budget.exceeded;
+    }
+};
+
+// first pass check of a deal. With no limits set this is just isSolvable()
+BudgetResult isSolvableWithinBudget(GameState* state, uint64_t maxNodes, int64_t maxMicros) {
+    if (maxNodes == 0 && maxMicros == 0) {
+        return isSolvable(state) ? SOLVABLE : UNSOLVABLE;
+    }
+    if (hasThreeJacks(state)) {
+        return UNSOLVABLE;
+    }
+    SearchBudget budget = { maxNodes, maxMicros, 0, chrono::steady_clock::now() + chrono::microseconds(maxMicros), false };
+    unordered_set<GameState, GameStateHasher> visited;
+    GameState active = *state;
+    BudgetProbe probe(budget);
+    bool solvable = solve(active, visited, probe);
+    if (budget.exceeded) return OVER_BUDGET;
+    return solvable ? SOLVABLE : UNSOLVABLE;
+}
+
+/* The escalation tier: solves every parked deal with no budget, one deal at a time with all numThreads threads
+  on it (see parallelSolver.h) and a 16M slot visited table. Returns how many of them are unsolvable,
+  and if unsolvableDeals is given the position in overflow of each unsolvable deal is added to it.
+*/
+int solveOverflow(const vector<GameState>& overflow, int numThreads, vector<size_t>* unsolvableDeals = nullptr) {
+    if (overflow.empty()) return 0;
+    ConcurrentVisitedSet visited(24);
+    int unsolvable = 0;
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        GameState active = overflow[i];
+        if (!isSolvableParallel(&active, numThreads, visited)) {
+            unsolvable++;
+            if (unsolvableDeals) unsolvableDeals->push_back(i);
+        }
+    }
+    return unsolvable;
+}
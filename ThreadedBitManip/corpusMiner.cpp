@@ -0,0 +1,170 @@
+/* Mines a stress corpus of hard deals. Solves random deals in bulk and keeps the K hardest solvable and the K hardest
+  unsolvable ones, by search nodes (states visited) or by solve time, so worst case optimizations can be measured on
+  the deals that dominate run time instead of on the mostly easy deals of benchmarkDecks.txt.
+  Build: cl /O2 /EHsc corpusMiner.cpp   or   g++ -O2 corpusMiner.cpp -pthread -o corpusMiner
+  Usage: corpusMiner <deals> [K, 100] [nodes | time] [seed, 0 for random] [output, ../BenchmarkGen/hardDecks]
+
+  Writes <output>.txt in the benchmarkDecks.txt format (one deal per line, 52 card indices 0-51), so main.cpp can load
+  it as its benchmarkDeckFile, and <output>.metrics.txt with the metrics of the deal on the same line of the corpus.
+  The corpus has the unsolvable deals first, then the solvable ones, each hardest first.
+  Deal i of a seed is always the same deal, the one main.cpp plays as deal i of that seed (see seededDeck in gameState.h),
+  so a mining run can be repeated from the seed it reports.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gameState.h"
+#include "print.h"
+#include "solver.h"
+#include "numa.h"
+
+// a mined deal and what solving it took
+struct MinedDeal {
+    int deck[52];
+    uint64_t index;
+    uint64_t nodes;
+    uint64_t micros;
+    bool solvable;
+};
+
+// the metric deals are ranked by
+enum Hardness { BY_NODES, BY_TIME };
+
+uint64_t hardness(const MinedDeal& deal, Hardness by) {
+    return by == BY_NODES ? deal.nodes : deal.micros;
+}
+
+// the K hardest deals seen, the easiest of them on top so it can be replaced
+class HardestDeals {
+public:
+    HardestDeals(size_t k, Hardness by) : k(k), by(by), heap(Easier(by)) {}
+
+    void offer(const MinedDeal& deal) {
+        if (heap.size() < k) {
+            heap.push(deal);
+        } else if (k && hardness(deal, by) > hardness(heap.top(), by)) {
+            heap.pop();
+            heap.push(deal);
+        }
+    }
+
+    // empties the set into a list, hardest first
+    vector<MinedDeal> take() {
+        vector<MinedDeal> deals;
+        while (!heap.empty()) {
+            deals.push_back(heap.top());
+            heap.pop();
+        }
+        reverse(deals.begin(), deals.end());
+        return deals;
+    }
+
+private:
+    struct Easier {
+        Hardness by;
+        explicit Easier(Hardness by) : by(by) {}
+        bool operator()(const MinedDeal& a, const MinedDeal& b) const { return hardness(a, by) > hardness(b, by); }
+    };
+    size_t k;
+    Hardness by;
+    priority_queue<MinedDeal, vector<MinedDeal>, Easier> heap;
+};
+
+// function which runs on a thread, solving every numThreads'th deal from first and offering each to its own hardest sets
+void mineDeals(uint64_t first, uint64_t count, int numThreads, uint64_t seed, HardestDeals& solvable, HardestDeals& unsolvable) {
+    Arena arena;
+    initArena(arena, size_t(64) << 20, true);
+    for (uint64_t index = first; index < count; index += numThreads) {
+        MinedDeal deal;
+        deal.index = index;
+        seededDeck(deal.deck, seed, index);
+        GameState state = createGameState(deal.deck);
+        auto start = chrono::steady_clock::now();
+        if (hasThreeJacks(&state)) {
+            deal.solvable = false;
+            deal.nodes = 0;
+        } else {
+            ArenaVisitedSet visited(64, GameStateHasher(), equal_to<GameState>(), ArenaAllocator<GameState>(&arena));
+            deal.solvable = solve(state, visited);
+            deal.nodes = visited.size();
+        }
+        resetArena(arena);
+        deal.micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        (deal.solvable ? solvable : unsolvable).offer(deal);
+    }
+    freeLocal(arena.block);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <deals> [K] [nodes | time] [seed] [output]" << endl;
+        return 1;
+    }
+    const uint64_t count = stoull(argv[1]);
+    const size_t k = argc > 2 ? stoul(argv[2]) : 100;
+    const Hardness by = argc > 3 && string(argv[3]) == "time" ? BY_TIME : BY_NODES;
+    uint64_t seed = argc > 4 ? stoull(argv[4]) : 0;
+    const string output = argc > 5 ? argv[5] : "../BenchmarkGen/hardDecks";
+    if (!seed) {
+        random_device rd;
+        seed = (uint64_t(rd()) << 32) | rd();
+    }
+    const int numThreads = max(1, int(thread::hardware_concurrency()));
+    cout << "Mining " << count << " deals from seed " << seed << " on " << numThreads << " threads, keeping the "
+        << k << " hardest of each kind by " << (by == BY_NODES ? "nodes" : "time") << endl;
+
+    auto start = chrono::steady_clock::now();
+    vector<HardestDeals> solvable(numThreads, HardestDeals(k, by));
+    vector<HardestDeals> unsolvable(numThreads, HardestDeals(k, by));
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(mineDeals, uint64_t(i), count, numThreads, seed, ref(solvable[i]), ref(unsolvable[i]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    // merge the threads' sets
+    HardestDeals hardestSolvable(k, by), hardestUnsolvable(k, by);
+    for (int i = 0; i < numThreads; ++i) {
+        for (const MinedDeal& deal : solvable[i].take()) hardestSolvable.offer(deal);
+        for (const MinedDeal& deal : unsolvable[i].take()) hardestUnsolvable.offer(deal);
+    }
+    vector<MinedDeal> unsolvableDeals = hardestUnsolvable.take();
+    vector<MinedDeal> solvableDeals = hardestSolvable.take();
+    vector<MinedDeal> corpus = unsolvableDeals;
+    corpus.insert(corpus.end(), solvableDeals.begin(), solvableDeals.end());
+
+    ofstream decks(output + ".txt");
+    ofstream metrics(output + ".metrics.txt");
+    if (!decks || !metrics) {
+        cerr << "Could not create " << output << ".txt or its metrics file" << endl;
+        return 1;
+    }
+    for (const MinedDeal& deal : corpus) {
+        for (int i = 0; i < 52; ++i) {
+            decks << deal.deck[i] << " ";
+        }
+        decks << endl;
+        metrics << (deal.solvable ? "solvable" : "unsolvable") << " nodes " << deal.nodes << " micros " << deal.micros
+            << " seed " << seed << " index " << deal.index << endl;
+    }
+    auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    cout << "Wrote " << corpus.size() << " deals to " << output << ".txt in " << duration.count() << " milliseconds." << endl;
+    if (!unsolvableDeals.empty()) {
+        cout << "Hardest unsolvable deal: " << unsolvableDeals.front().nodes << " nodes, " << unsolvableDeals.front().micros << " microseconds" << endl;
+    }
+    if (!solvableDeals.empty()) {
+        cout << "Hardest solvable deal: " << solvableDeals.front().nodes << " nodes, " << solvableDeals.front().micros << " microseconds" << endl;
+    }
+    return 0;
+}
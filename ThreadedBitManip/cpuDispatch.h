@@ -0,0 +1,200 @@
+#pragma once
+
+/* Runtime CPU feature dispatch. The hot kernels of the search (hashing, move generation and the three jacks
+  prefilter, see searchKernel.h) are compiled three times into one binary: plain C++, AVX2 (with BMI) and AVX-512
+  (F, BW and VL). Each copy lives in its own namespace and is built for its own target with a GCC/Clang target
+  pragma, so nothing outside it needs -mavx2 and the binary still starts on any x86-64 machine. searchKernels()
+  reads CPUID once and hands out the widest set the CPU and the OS (XSAVE state in XCR0) both support.
+  The environment variable GAY_GORDONS_KERNELS=scalar|avx2|avx512 caps the choice, for comparing the levels on
+  one machine. Every level gives the same hashes and plays the moves in the same order, so they all visit the
+  same states as solve().
+  Anything that isn't x86 gets the plain C++ kernels only.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+
+#include "solver.h"
+#include "latticeDP.h"
+#include "numa.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define KERNELS_X86 0
+#endif
+
+// the partner of every card as bytes, for a table lookup of all the top cards at once. Cards without one (and the
+// empty card) get a value no top card has
+struct PartnerTable {
+    alignas(16) uint8_t partner[16];
+};
+
+const PartnerTable& partnerTable() {
+    static const PartnerTable table = [] {
+        PartnerTable t;
+        for (int card = 0; card < 16; ++card) {
+            t.partner[card] = 0xEE;
+            for (int other = 0; other < 15 && card < 15; ++other) {
+                if (isPair(card, other)) {
+                    t.partner[card] = static_cast<uint8_t>(other);
+                    break;
+                }
+            }
+        }
+        return t;
+    }();
+    return table;
+}
+
+namespace scalarKernels {
+#define KERNEL_LEVEL 0
+#include "searchKernel.h"
+#undef KERNEL_LEVEL
+}
+
+#if KERNELS_X86
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,bmi,bmi2,popcnt"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,bmi,bmi2,popcnt")
+#endif
+namespace avx2Kernels {
+#define KERNEL_LEVEL 1
+#include "searchKernel.h"
+#undef KERNEL_LEVEL
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt")
+// GCC 12's AVX-512 headers start some intrinsics from an uninitialized "undefined" register and -Wall flags every use
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+namespace avx512Kernels {
+#define KERNEL_LEVEL 2
+#include "searchKernel.h"
+#undef KERNEL_LEVEL
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+#endif
+
+enum KernelLevel { SCALAR_KERNELS, AVX2_KERNELS, AVX512_KERNELS };
+const char* const KERNEL_LEVEL_NAMES[] = { "scalar", "avx2", "avx512" };
+
+// what the CPU and the OS support, the widest level usable
+struct CpuFeatures {
+    bool avx2;
+    bool bmi;
+    bool avx512;
+    KernelLevel best;
+};
+
+#if KERNELS_X86
+// helper to read a CPUID leaf, registers in the order eax, ebx, ecx, edx
+inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4]) {
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i) {
+        registers[i] = static_cast<uint32_t>(r[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// helper to read XCR0, which register state the OS saves on a context switch
+inline uint64_t readXcr0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (uint64_t(high) << 32) | low;
+#endif
+}
+#endif
+
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures features = { false, false, false, SCALAR_KERNELS };
+#if KERNELS_X86
+    uint32_t r[4];
+    cpuid(0, 0, r);
+    uint32_t maxLeaf = r[0];
+    if (maxLeaf < 7) return features;
+    cpuid(1, 0, r);
+    bool osxsave = (r[2] >> 27) & 1, avx = (r[2] >> 28) & 1;
+    if (!osxsave || !avx) return features;
+    uint64_t xcr0 = readXcr0();
+    bool ymmSaved = (xcr0 & 0x6) == 0x6;      // SSE and AVX state
+    bool zmmSaved = (xcr0 & 0xE6) == 0xE6;    // and the opmask and upper ZMM state
+    cpuid(7, 0, r);
+    features.bmi = ((r[1] >> 3) & 1) && ((r[1] >> 8) & 1);
+    features.avx2 = ymmSaved && ((r[1] >> 5) & 1);
+    features.avx512 = zmmSaved && ((r[1] >> 16) & 1) && ((r[1] >> 30) & 1) && ((r[1] >> 31) & 1);
+    if (features.avx2 && features.bmi) features.best = AVX2_KERNELS;
+    if (features.best == AVX2_KERNELS && features.avx512) features.best = AVX512_KERNELS;
+#endif
+    return features;
+}
+
+// one level's kernels
+struct SearchKernels {
+    KernelLevel level;
+    const char* name;
+    bool (*isSolvable)(GameState* state);
+    uint32_t (*hash)(const GameState& state);
+    bool (*solveInArena)(GameState* state, Arena& arena, uint32_t* statesVisited);
+};
+
+// helper to get a level's kernels, the widest compiled in if the level isn't
+SearchKernels kernelsFor(KernelLevel level) {
+#if KERNELS_X86
+    if (level == AVX512_KERNELS) {
+        return SearchKernels{ level, KERNEL_LEVEL_NAMES[level], avx512Kernels::isSolvableDeal, avx512Kernels::hashState, avx512Kernels::solveInArena };
+    }
+    if (level == AVX2_KERNELS) {
+        return SearchKernels{ level, KERNEL_LEVEL_NAMES[level], avx2Kernels::isSolvableDeal, avx2Kernels::hashState, avx2Kernels::solveInArena };
+    }
+#endif
+    return SearchKernels{ SCALAR_KERNELS, KERNEL_LEVEL_NAMES[SCALAR_KERNELS], scalarKernels::isSolvableDeal, scalarKernels::hashState, scalarKernels::solveInArena };
+}
+
+// the kernels for this machine, picked on first use: the widest supported level, capped by GAY_GORDONS_KERNELS
+const SearchKernels& searchKernels() {
+    static const SearchKernels kernels = [] {
+        KernelLevel level = detectCpuFeatures().best;
+        const char* cap = getenv("GAY_GORDONS_KERNELS");
+        if (cap) {
+            for (int l = SCALAR_KERNELS; l <= AVX512_KERNELS; ++l) {
+                if (strcmp(cap, KERNEL_LEVEL_NAMES[l]) == 0 && l < level) level = static_cast<KernelLevel>(l);
+            }
+        }
+        return kernelsFor(level);
+    }();
+    return kernels;
+}
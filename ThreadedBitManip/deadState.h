@@ -0,0 +1,218 @@
+#pragma once
+
+/* Dead state detection during the search. hasThreeJacks() only looks at the deal, but positions deep in the search go
+  dead for the same kind of reason all the time. Every card pairs with one rank (the jacks with each other), so the
+  cards fall into pair classes: {A, 10}, {2, 9}, {3, 8}, {4, 7}, {5, 6}, {Q, K} and {J}. The search keeps, per class,
+  how many of its cards are left in each slot (the ten piles and the reserve) next to the state. Every remove and
+  add of a card updates one count, and before a state is expanded two cheap necessary conditions are tested:
+    - crowded slot: a slot holds more than half of a class's remaining cards. Two cards in the same slot can never
+      be paired with each other, so some card in that slot has no partner left outside it. For the jacks in the deal
+      this is the three jacks rule, and it also covers the reserve's cards having no partner left anywhere else.
+    - crossed pairs: two classes are down to their last pair each, both pairs spread over the same two slots, and the
+      cards are stacked crossed: a above b in one slot, b's partner above a's partner in the other. a waits for b's
+      partner to go, which waits for b, which is under a.
+  A state that fails either test can't be cleared and is cut before its visited lookup. With verification on, every
+  cut state is also searched exhaustively with solve(), and any that turns out solvable is counted against its rule.
+*/
+
+#include <cstdint>
+#include <unordered_set>
+
+#include "solver.h"
+
+// the pile slots, then the reserve
+const int NUM_SLOTS = NUM_PILES + 1;
+const int MAX_PAIR_CLASSES = 8;
+// counts are 5 bit fields, one per slot
+const int SLOT_FIELD_BITS = 5;
+
+enum DeadStateRule { DEAD_CROWDED_SLOT, DEAD_CROSSED_PAIRS, DEAD_RULE_COUNT };
+const char* const DEAD_RULE_NAMES[DEAD_RULE_COUNT] = { "crowded slot", "crossed pairs" };
+
+// the pair class of every card, from the rules' isPair, and per class the bias the crowded slot test adds
+struct PairClasses {
+    int8_t classOf[16];       // -1 for the empty card
+    int count;
+    uint64_t fieldHighBits;   // bit 4 of every slot's field
+    uint64_t crowdedBias[5];  // [half of the class's remaining cards]: 15 - half in every field
+};
+
+// the pair classes, built on first use
+const PairClasses& pairClasses() {
+    static const PairClasses classes = [] {
+        PairClasses c;
+        c.count = 0;
+        for (int card = 0; card < 16; ++card) {
+            c.classOf[card] = -1;
+        }
+        for (int card = 0; card < 15; ++card) {
+            for (int partner = 0; partner < 15; ++partner) {
+                if (isPair(card, partner)) {
+                    c.classOf[card] = partner < card ? c.classOf[partner] : int8_t(c.count++);
+                    break;
+                }
+            }
+        }
+        c.fieldHighBits = 0;
+        for (int s = 0; s < NUM_SLOTS; ++s) {
+            c.fieldHighBits |= uint64_t(1) << (SLOT_FIELD_BITS * s + 4);
+        }
+        for (int half = 0; half < 5; ++half) {
+            c.crowdedBias[half] = 0;
+            for (int s = 0; s < NUM_SLOTS; ++s) {
+                c.crowdedBias[half] |= uint64_t(15 - half) << (SLOT_FIELD_BITS * s);
+            }
+        }
+        return c;
+    }();
+    return classes;
+}
+
+// where the cards of each class are: a count per slot, and the total left
+struct DeadStateTracker {
+    uint64_t slotCounts[MAX_PAIR_CLASSES];
+    int remaining[MAX_PAIR_CLASSES];
+};
+
+inline void trackRemove(DeadStateTracker& tracker, int card, int slot) {
+    int k = pairClasses().classOf[card];
+    tracker.slotCounts[k] -= uint64_t(1) << (SLOT_FIELD_BITS * slot);
+    tracker.remaining[k]--;
+}
+
+inline void trackAdd(DeadStateTracker& tracker, int card, int slot) {
+    int k = pairClasses().classOf[card];
+    tracker.slotCounts[k] += uint64_t(1) << (SLOT_FIELD_BITS * slot);
+    tracker.remaining[k]++;
+}
+
+void initDeadStateTracker(DeadStateTracker& tracker, const GameState& state) {
+    for (int k = 0; k < MAX_PAIR_CLASSES; ++k) {
+        tracker.slotCounts[k] = 0;
+        tracker.remaining[k] = 0;
+    }
+    for (int i = 0; i < NUM_PILES; ++i) {
+        for (int d = 0; d < PILE_SIZE; ++d) {
+            int card = (state.piles[i] >> (4 * d)) & 0x0F;
+            if (card != 15) trackAdd(tracker, card, i);
+        }
+    }
+    for (int d = 0; d < RESERVE_SIZE; ++d) {
+        int card = (state.reserve >> (4 * d)) & 0x0F;
+        if (card != 15) trackAdd(tracker, card, NUM_PILES);
+    }
+}
+
+// helper to get how deep the first card of class k is in a slot, counting from the top card
+inline int classDepth(const GameState& state, int slot, int k) {
+    const int8_t* classOf = pairClasses().classOf;
+    uint32_t word = slot < NUM_PILES ? state.piles[slot] : state.reserve;
+    int depth = 0;
+    while (classOf[word & 0x0F] != k) {
+        word >>= 4;
+        depth++;
+    }
+    return depth;
+}
+
+// returns the first rule that proves the state dead, or -1
+int deadStateRule(const GameState& state, const DeadStateTracker& tracker) {
+    const PairClasses& classes = pairClasses();
+    // crowded slot, all eleven slots of a class in one add and mask: a field goes past 15 exactly when it is over half
+    for (int k = 0; k < classes.count; ++k) {
+        if ((tracker.slotCounts[k] + classes.crowdedBias[tracker.remaining[k] / 2]) & classes.fieldHighBits) {
+            return DEAD_CROWDED_SLOT;
+        }
+    }
+    // crossed pairs, among the classes down to their last two cards (not in the same slot, that was crowded)
+    int lastPairs[MAX_PAIR_CLASSES], slotsOf[MAX_PAIR_CLASSES][2];
+    int numLastPairs = 0;
+    for (int k = 0; k < classes.count; ++k) {
+        if (tracker.remaining[k] != 2) continue;
+        int found = 0;
+        for (int s = 0; s < NUM_SLOTS && found < 2; ++s) {
+            if ((tracker.slotCounts[k] >> (SLOT_FIELD_BITS * s)) & 0x1F) {
+                slotsOf[numLastPairs][found++] = s;
+            }
+        }
+        lastPairs[numLastPairs++] = k;
+    }
+    for (int x = 0; x < numLastPairs; ++x) {
+        for (int y = x + 1; y < numLastPairs; ++y) {
+            if (slotsOf[x][0] != slotsOf[y][0] || slotsOf[x][1] != slotsOf[y][1]) continue;
+            int p = slotsOf[x][0], q = slotsOf[x][1];
+            bool xOnTopInP = classDepth(state, p, lastPairs[x]) < classDepth(state, p, lastPairs[y]);
+            bool xOnTopInQ = classDepth(state, q, lastPairs[x]) < classDepth(state, q, lastPairs[y]);
+            if (xOnTopInP != xOnTopInQ) return DEAD_CROSSED_PAIRS;
+        }
+    }
+    return -1;
+}
+
+// counters for the report, per thread and then summed
+struct DeadStateCounters {
+    uint64_t checks;                       // states tested
+    uint64_t hits[DEAD_RULE_COUNT];        // states cut by each rule
+    uint64_t verified[DEAD_RULE_COUNT];    // cuts that were checked with solve()
+    uint64_t wrong[DEAD_RULE_COUNT];       // of those, states solve() could clear. Should always be 0
+};
+
+// the probe that runs solve() with the tracker kept up to date and dead states cut before they are looked up
+struct DeadStateProbe : NoProbe {
+    DeadStateTracker tracker;
+    DeadStateCounters& counters;
+    bool verify;
+
+    DeadStateProbe(const GameState& deal, DeadStateCounters& counters, bool verify) : counters(counters), verify(verify) {
+        initDeadStateTracker(tracker, deal);
+    }
+
+    bool prune(const GameState& state) {
+        counters.checks++;
+        int rule = deadStateRule(state, tracker);
+        if (rule < 0) return false;
+        counters.hits[rule]++;
+        if (verify) {
+            unordered_set<GameState, GameStateHasher> fresh;
+            GameState copy = state;
+            counters.verified[rule]++;
+            counters.wrong[rule] += solve(copy, fresh);
+        }
+        return true;
+    }
+    void removed(int card, int slot) {
+        trackRemove(tracker, card, slot);
+    }
+    void added(int card, int slot) {
+        trackAdd(tracker, card, slot);
+    }
+};
+
+// function which checks to see if a state is solvable, cutting dead states on the way. verify checks every cut with solve()
+bool isSolvableWithDeadStates(GameState* state, DeadStateCounters& counters, bool verify = false) {
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    DeadStateProbe probe(*state, counters, verify);
+    unordered_set<GameState, GameStateHasher> visited;
+    GameState active = *state;
+    return solve(active, visited, probe);
+}
+
+void addDeadStateCounters(DeadStateCounters& into, const DeadStateCounters& from) {
+    into.checks += from.checks;
+    for (int r = 0; r < DEAD_RULE_COUNT; ++r) {
+        into.hits[r] += from.hits[r];
+        into.verified[r] += from.verified[r];
+        into.wrong[r] += from.wrong[r];
+    }
+}
+
+void printDeadStateCounters(const DeadStateCounters& counters) {
+    cout << "Dead state checks: " << counters.checks << endl;
+    for (int r = 0; r < DEAD_RULE_COUNT; ++r) {
+        cout << "  " << DEAD_RULE_NAMES[r] << ": " << counters.hits[r] << " states cut";
+        if (counters.verified[r]) cout << ", " << counters.verified[r] << " verified with solve(), " << counters.wrong[r] << " wrong";
+        cout << endl;
+    }
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+/* Delta solving for families of nearly identical deals: every transposition of two cards of one base deal.
+  A position of a deal is fixed by how deep each pile and the reserve are (stateKey()), and its future only depends on
+  the cards still in play. Swapping the cards at two deck positions changes nothing for a position where both of them
+  have already been played, it has the same cards left as the base deal's position with the same depths.
+  So the base deal is explored once, exhaustively (every move, not just up to the first win), and the won or lost
+  verdict of every position it reaches is kept. A neighbour is then solved with solve()'s search, and any position
+  where both swapped cards are gone takes the base verdict instead of being searched. Only the positions that still
+  hold a swapped card (and the odd one the base deal can't reach) are explored. Swapping two cards of the same rank
+  gives the base deal again.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+#include "interleave.h"
+#include "hintEngine.h"
+
+// a deck position in the deal: its slot (a pile, or NUM_PILES for the reserve) and how many cards start above it
+struct DealPosition {
+    int slot;
+    int above;
+};
+
+// helper to find a deck index in the deal, createGameState() puts the last card of each pile's five on top
+inline DealPosition dealPosition(int deckIndex) {
+    if (deckIndex < NUM_PILES * PILE_SIZE) {
+        return DealPosition{ deckIndex / PILE_SIZE, PILE_SIZE - 1 - deckIndex % PILE_SIZE };
+    }
+    return DealPosition{ NUM_PILES, NUM_PILES * PILE_SIZE + RESERVE_SIZE - 1 - deckIndex };
+}
+
+// helper to check if the card that started at a deal position has been played
+inline bool positionPlayed(const GameState& state, const DealPosition& position) {
+    int played = position.slot < NUM_PILES ? PILE_SIZE - packedCardCount(state.piles[position.slot])
+        : RESERVE_SIZE - packedCardCount(0xFFFFFF00u | state.reserve);
+    return played > position.above;
+}
+
+struct DeltaStats {
+    uint64_t baseNodes;      // positions of the base deal explored
+    uint64_t neighbours;     // perturbed deals solved
+    uint64_t sameRank;       // of those, swaps of two cards of the same rank
+    uint64_t nodes;          // positions the neighbours searched themselves
+    uint64_t reused;         // positions the neighbours took from the base deal
+    int64_t baseNanos;
+    int64_t neighbourNanos;
+};
+
+class DeltaSolver {
+public:
+    // explores the base deal, a shuffled deck as createGameState() takes it
+    explicit DeltaSolver(const int baseDeck[NUM_PILES * PILE_SIZE + RESERVE_SIZE]) : stats() {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < NUM_CARDS; ++i) {
+            deck[i] = baseDeck[i];
+        }
+        base = createGameState(deck);
+        verdicts.init(size_t(4) << LANE_TABLE_LOG2);
+        visited.init(LANE_TABLE_LOG2);
+        GameState state = base;
+        baseSolvable = !hasThreeJacks(&state) && exploreBase(state);
+        stats.baseNanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+
+    bool solvable() const { return baseSolvable; }
+
+    // returns true if the base deal with the cards at deck indices x and y swapped can be cleared
+    bool solveSwap(int x, int y) {
+        auto start = chrono::steady_clock::now();
+        stats.neighbours++;
+        if (StandardRules::card(deck[x]) == StandardRules::card(deck[y])) {
+            stats.sameRank++;
+            return baseSolvable;
+        }
+        swap(deck[x], deck[y]);
+        GameState state = createGameState(deck);
+        swap(deck[x], deck[y]);
+        swapped[0] = dealPosition(x);
+        swapped[1] = dealPosition(y);
+        visited.reset();
+        bool solvable = !hasThreeJacks(&state) && solveNeighbour(state);
+        stats.neighbourNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        return solvable;
+    }
+
+    const DeltaStats& statistics() const { return stats; }
+
+private:
+    static const int NUM_CARDS = NUM_PILES * PILE_SIZE + RESERVE_SIZE;
+
+    // the base deal's memo for solveVerdict(), every position it reaches is searched once and kept
+    struct BaseMemo {
+        DeltaSolver& solver;
+        int lookup(const GameState&, uint32_t key) {
+            int known = solver.verdicts.lookup(key);
+            if (known < 0) solver.stats.baseNodes++;
+            return known;
+        }
+        void record(const GameState&, uint32_t key, bool won) {
+            if (solver.verdicts.count >= solver.verdicts.limit) solver.verdicts.grow();
+            solver.verdicts.record(key, won);
+        }
+    };
+
+    /* a neighbour's memo: the base verdict wherever both swapped cards are gone, otherwise the neighbour's own visited
+      set. Positions form a DAG, so one already visited in this search has been searched and was lost */
+    struct NeighbourMemo {
+        DeltaSolver& solver;
+        int lookup(const GameState& state, uint32_t key) {
+            if (solver.bothPlayed(state)) {
+                int known = solver.verdicts.lookup(key);
+                if (known >= 0) {
+                    solver.stats.reused++;
+                    return known;
+                }
+            }
+            if (!solver.visited.insertAt(key, solver.visited.slotFor(key))) return 0;
+            solver.stats.nodes++;
+            return -1;
+        }
+        // a position the base deal never reached, with the base deal's cards left, is good for every later neighbour too
+        void record(const GameState& state, uint32_t key, bool won) {
+            if (!solver.bothPlayed(state)) return;
+            if (solver.verdicts.count >= solver.verdicts.limit) solver.verdicts.grow();
+            solver.verdicts.record(key, won);
+        }
+    };
+
+    bool bothPlayed(const GameState& state) const {
+        return positionPlayed(state, swapped[0]) && positionPlayed(state, swapped[1]);
+    }
+
+    // every move from every position, so each position the base deal can reach gets its verdict
+    bool exploreBase(GameState& state) {
+        BaseMemo memo = { *this };
+        return solveVerdict<true>(state, memo);
+    }
+
+    // solve()'s search of the neighbour, taking the base verdict wherever both swapped cards are gone
+    bool solveNeighbour(GameState& state) {
+        NeighbourMemo memo = { *this };
+        return solveVerdict<false>(state, memo);
+    }
+
+    int deck[NUM_CARDS];
+    GameState base;
+    bool baseSolvable;
+    HintMemo verdicts;       // the base deal's positions, won or lost
+    LaneTable visited;       // the current neighbour's own positions
+    DealPosition swapped[2];
+    DeltaStats stats;
+};
+
+/* solves every transposition of two cards of a deal, in the order (0, 1), (0, 2) ... (50, 51). solvable gets one
+  entry per swap, returns how many are unsolvable */
+int solveTranspositions(DeltaSolver& solver, vector<bool>& solvable) {
+    const int cards = NUM_PILES * PILE_SIZE + RESERVE_SIZE;
+    solvable.clear();
+    int unsolvable = 0;
+    for (int x = 0; x < cards; ++x) {
+        for (int y = x + 1; y < cards; ++y) {
+            bool result = solver.solveSwap(x, y);
+            solvable.push_back(result);
+            unsolvable += !result;
+        }
+    }
+    return unsolvable;
+}
+
+void printDeltaStats(const DeltaStats& stats) {
+    double neighbours = stats.neighbours ? double(stats.neighbours) : 1.0;
+    cout << "Neighbours: " << stats.neighbours << " (" << stats.sameRank << " same rank swaps), "
+        << stats.nodes / neighbours << " positions searched and " << stats.reused / neighbours << " taken from the base per neighbour, "
+        << stats.neighbourNanos / neighbours / 1000 << " us each" << endl;
+}
+
+void addDeltaStats(DeltaStats& into, const DeltaStats& from) {
+    into.baseNodes += from.baseNodes;
+    into.neighbours += from.neighbours;
+    into.sameRank += from.sameRank;
+    into.nodes += from.nodes;
+    into.reused += from.reused;
+    into.baseNanos += from.baseNanos;
+    into.neighbourNanos += from.neighbourNanos;
+}
+
+/* scans the transpositions of the first numDeals decks of a deck file (one per line, like loadDecksToStates()),
+  printing how many neighbours of each deal are unsolvable, then the totals */
+void runTranspositionScan(const char* path, int numDeals) {
+    std::ifstream infile(path);
+    std::string line;
+    DeltaStats total = DeltaStats();
+    int deals = 0;
+    while (deals < numDeals && getline(infile, line)) {
+        int deck[NUM_PILES * PILE_SIZE + RESERVE_SIZE];
+        if (!parseDeckLine(line, deck)) continue;
+        DeltaSolver solver(deck);
+        vector<bool> solvable;
+        int unsolvable = solveTranspositions(solver, solvable);
+        cout << "Deal " << deals << (solver.solvable() ? " (solvable): " : " (unsolvable): ") << unsolvable << " of "
+            << solvable.size() << " transpositions unsolvable" << endl;
+        addDeltaStats(total, solver.statistics());
+        deals++;
+    }
+    double perDeal = deals ? double(deals) : 1.0;
+    cout << "Base deals: " << total.baseNodes / perDeal << " positions explored in " << total.baseNanos / perDeal / 1000 << " us each" << endl;
+    printDeltaStats(total);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+/* Level synchronous frontier search. Every move takes two cards, so the states of a deal come in layers by the number
+  of cards gone and a state only ever shows up in one layer (see bidirectional.h). This engine expands a whole layer
+  at a time: every successor of the layer goes into one flat array of stateKey() keys, the array is radix sorted and
+  duplicates dropped in one pass, and that is the next layer. The layer before is thrown away, so there is no visited
+  set at all and all the memory traffic is sequential. Big layers are expanded by several threads from the shared pool
+  (see workerPool.h), each claiming chunks of the layer and keeping its successors in its own slice.
+  It always explores every reachable state (the goal is the very last layer), so it is for the deals solve() has to
+  explore completely anyway, the unsolvable ones.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "bidirectional.h"
+#include "workerPool.h"
+
+// layers smaller than this are sorted with std::sort, radix sort only pays off on bigger ones
+const size_t RADIX_SORT_MIN = 1024;
+// layers at least this big are split between the threads, in chunks of LAYER_CHUNK keys. The widest layers of the
+// hard deals are around 8K keys, and waking the pool's workers costs about as much as expanding a few hundred
+const size_t PARALLEL_LAYER_MIN = 2048;
+const size_t LAYER_CHUNK = 256;
+
+/* sorts 28 bit keys (stateKey() keys are below 3 * 6^10 < 2^28) with three LSD passes of 10, 10 and 8 bits.
+  scratch must be as big as keys, the result ends up in keys */
+void radixSortKeys(vector<uint32_t>& keys, vector<uint32_t>& scratch) {
+    if (keys.size() < RADIX_SORT_MIN) {
+        sort(keys.begin(), keys.end());
+        return;
+    }
+    scratch.resize(keys.size());
+    const int shifts[3] = { 0, 10, 20 };
+    for (int pass = 0; pass < 3; ++pass) {
+        const int shift = shifts[pass];
+        size_t counts[1024] = {};
+        for (uint32_t key : keys) {
+            counts[(key >> shift) & 1023]++;
+        }
+        size_t total = 0;
+        for (int b = 0; b < 1024; ++b) {
+            size_t count = counts[b];
+            counts[b] = total;
+            total += count;
+        }
+        for (uint32_t key : keys) {
+            scratch[counts[(key >> shift) & 1023]++] = key;
+        }
+        keys.swap(scratch);
+    }
+}
+
+// statistics of one layered search
+struct LayeredStats {
+    uint64_t states;        // distinct states over all layers, the same as solve()'s visited set for an unsolvable deal
+    uint64_t generated;     // successors generated before deduplication
+    size_t widestLayer;
+    uint64_t splitLayers;   // layers expanded by more than one thread
+};
+
+/* returns true if the deal can be cleared, expanding layers bigger than PARALLEL_LAYER_MIN on numThreads threads */
+bool solveLayered(const GameState& deal, int numThreads = 1, LayeredStats* stats = nullptr) {
+    DealLayout layout;
+    initDealLayout(layout, deal);
+    const uint32_t goal = layout.reserveWeight * (RESERVE_SIZE + 1) - 1;
+    vector<uint32_t> layer(1, stateKey(deal));
+    vector<uint32_t> next, scratch;
+    vector<vector<uint32_t>> slices(numThreads > 1 ? numThreads : 0);
+    LayeredStats local = { 1, 0, 1, 0 };
+    bool solvable = false;
+    while (!layer.empty()) {
+        if (layer[0] == goal) {
+            solvable = true;
+            break;
+        }
+        next.clear();
+        if (numThreads > 1 && layer.size() >= PARALLEL_LAYER_MIN) {
+            WorkerPool& pool = sharedWorkerPool(numThreads);
+            const int helpers = min(numThreads - 1, pool.size());
+            atomic<size_t> nextChunk(0);
+            for (int t = 0; t <= helpers; ++t) {
+                slices[t].clear();
+            }
+            pool.run([&](int helper) {
+                size_t start = nextChunk.fetch_add(LAYER_CHUNK);
+                size_t end = min(layer.size(), start + LAYER_CHUNK);
+                for (size_t k = start; k < end; ++k) {
+                    expandForward(layout, layer[k], slices[helper]);
+                }
+                return end < layer.size();
+            }, helpers);
+            for (int t = 0; t <= helpers; ++t) {
+                next.insert(next.end(), slices[t].begin(), slices[t].end());
+            }
+            local.splitLayers++;
+        } else {
+            for (uint32_t key : layer) {
+                expandForward(layout, key, next);
+            }
+        }
+        local.generated += next.size();
+        radixSortKeys(next, scratch);
+        next.erase(unique(next.begin(), next.end()), next.end());
+        layer.swap(next);
+        local.states += layer.size();
+        local.widestLayer = max(local.widestLayer, layer.size());
+    }
+    if (stats) *stats = local;
+    return solvable;
+}
+
+// function which checks to see if a state is solvable with the layered search
+bool isSolvableLayered(GameState* state, int numThreads = 1, LayeredStats* stats = nullptr) {
+    if (hasThreeJacks(state)) {
+        if (stats) *stats = LayeredStats{ 0, 0, 0, 0 };
+        return false;
+    }
+    return solveLayered(*state, numThreads, stats);
+}
@@ -5,91 +5,191 @@
 #include <numeric>
 #include <random>
 #include <cstring>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <string>
 
-struct GameState {
-    uint32_t piles[10];
-    uint8_t reserve;
-    bool operator==(const GameState& other) const {
+#include "rules.h"
+
+/* A game state for the given rules (see rules.h). Each card gets Rules::cardBits bits of its pile's word,
+  with the top (in play) card in the lowest bits and the empty slots above it set to all ones (0x0F for 4 bit cards).
+  For the standard rules this is ten uint32_t piles and a uint8_t reserve.
+*/
+template <class Rules>
+struct BasicGameState {
+    typename Rules::PileWord piles[Rules::numPiles];
+    typename Rules::ReserveWord reserve;
+    bool operator==(const BasicGameState& other) const {
         return memcmp(this, &other, sizeof(*this)) == 0;
     }
 };
 
-// Function to initialize GameState with shuffled deck
-void initializeGameState(GameState* state) {
-    // Create a deck of cards (0-12 represent Ace to King)
-    uint8_t deck[52];
-    for (int i = 0; i < 52; ++i) {
-        deck[i] = i % 13; // 0-12 (Ace to King)
+typedef BasicGameState<StandardRules> GameState;
+
+// helper function to build a packed pile or reserve word from cards, top card first, filling the rest with empty slots
+template <class Rules, class Word>
+inline Word packCards(const int* cards, int count) {
+    Word packed = 0;
+    const int slots = int(sizeof(Word) * 8) / Rules::cardBits;
+    for (int j = 0; j < slots; ++j) {
+        Word card = j < count ? Word(cards[j]) : Word(Rules::emptyCard);
+        packed |= card << (j * Rules::cardBits);
     }
+    return packed;
+}
 
-    // Shuffle the deck using std::shuffle and a random engine
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(deck, deck + 52, g);
+// Function to deal a GameState from a deck shuffled with the given random engine
+template <class Rules, class RandomEngine>
+void dealGameState(BasicGameState<Rules>* state, RandomEngine& g) {
+    // Create a deck of cards (0-12 represent Ace to King in the standard game)
+    int deck[Rules::deckSize];
+    for (int i = 0; i < Rules::deckSize; ++i) {
+        deck[i] = Rules::card(i);
+    }
 
-    // Distribute cards into piles and reserve
-    for (int i = 0; i < 10; ++i) {
-        state->piles[i] = 0; // Initialize pile as empty
-        for (int j = 0; j < 5; ++j) {
-            state->piles[i] |= static_cast<uint32_t>(deck[i * 5 + j]) << (j * 4);
-        }
-        // fill the remaining slots with 0x0F
-        state->piles[i] |= 0x0F << (5 * 4);
-        state->piles[i] |= 0x0F << (6 * 4);
-        state->piles[i] |= 0x0F << (7 * 4);
+    // Shuffle the deck using std::shuffle and the random engine
+    std::shuffle(deck, deck + Rules::deckSize, g);
+
+    // Distribute cards into piles and reserve, the remaining slots are filled with the empty card
+    for (int i = 0; i < Rules::numPiles; ++i) {
+        state->piles[i] = packCards<Rules, typename Rules::PileWord>(deck + i * Rules::pileSize, Rules::pileSize);
     }
     // set reserve cards
-    state->reserve = (static_cast<uint8_t>(deck[50]) & 0x0F) | ((static_cast<uint8_t>(deck[51]) & 0x0F) << 4);
+    state->reserve = packCards<Rules, typename Rules::ReserveWord>(deck + Rules::numPiles * Rules::pileSize, Rules::reserveSize);
+}
+
+// Function to initialize GameState with shuffled deck
+template <class Rules>
+void initializeGameState(BasicGameState<Rules>* state) {
+    std::random_device rd;
+    std::mt19937 g(rd());
+    dealGameState(state, g);
+}
+
+// helper to scramble a 64 bit value (splitmix64's finaliser)
+inline uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+
+// helpers for the hasher: fold a packed word down to 32 bits
+template <class Word>
+inline uint32_t foldWord(Word word) { return static_cast<uint32_t>(word); }
+inline uint32_t foldWord(uint64_t word) { return static_cast<uint32_t>(word ^ (word >> 32)); }
+
+// helper to rotate a 32 bit word left. _rotl is MSVC only, GCC and Clang turn the shifts into one rotate instruction
+inline uint32_t rotl32(uint32_t value, int shift) {
+#ifdef _MSC_VER
+    return _rotl(value, shift);
+#else
+    shift &= 31;
+    return (value << shift) | (value >> ((32 - shift) & 31));
+#endif
 }
 
 // Hasher for GameState
-struct GameStateHasher {
-    size_t operator()(const GameState& state) const {
+template <class Rules>
+struct BasicGameStateHasher {
+    size_t operator()(const BasicGameState<Rules>& state) const {
         size_t hash = 0;
-        for (int i = 0; i < 10; ++i) {
-            hash ^= _rotl(state.piles[i], i % 32);
+        for (int i = 0; i < Rules::numPiles; ++i) {
+            hash ^= rotl32(foldWord(state.piles[i]), i % 32);
         }
-        hash ^= _rotl(state.reserve, 10); // Rotate reserve by a fixed amount
+        hash ^= rotl32(foldWord(state.reserve), 10); // Rotate reserve by a fixed amount
         return hash;
     }
 };
 
-// a function which creates and returns a game state from a given shuffled array of 52 cards 
-GameState createGameState(const int deck[52]) {
-    GameState state;
+typedef BasicGameStateHasher<StandardRules> GameStateHasher;
+
+// helper function to count the cards left in a packed pile (or reserve) word.
+// Cards are never 0x0F, so every nibble that isn't 0x0F holds a card. The nibbles are
+// inverted so empty slots become zero, each nibble is folded down to its low bit and the
+// resulting bits are summed with a multiply, which keeps it branch free.
+inline int packedCardCount(uint32_t packed) {
+    uint32_t inverted = ~packed;
+    uint32_t nonEmpty = (inverted | (inverted >> 1) | (inverted >> 2) | (inverted >> 3)) & 0x11111111;
+    return static_cast<int>((nonEmpty * 0x11111111) >> 28);
+}
+
+/* For a fixed deal a state is fully described by how many cards were removed from each pile
+  and from the reserve: 6^10 * 3 combinations, which fits in 28 bits. This packs those depths
+  into a mixed radix key, so a state can be stored in a single uint32_t instead of a whole GameState.
+  Keys are only comparable between states of the same deal.
+*/
+inline uint32_t stateKey(const GameState& state) {
+    uint32_t key = 2 - packedCardCount(0xFFFFFF00u | state.reserve);
     for (int i = 0; i < 10; ++i) {
-        state.piles[i] = 0;
-        for (int j = 0; j < 5; ++j) {
+        key = key * 6 + (5 - packedCardCount(state.piles[i]));
+    }
+    return key;
+}
+
+// a function which creates and returns a game state from a given shuffled array of deck indices (or ranks, for the standard game)
+template <class Rules = StandardRules>
+BasicGameState<Rules> createGameState(const int deck[Rules::deckSize]) {
+    BasicGameState<Rules> state;
+    int cards[Rules::pileSize > Rules::reserveSize ? Rules::pileSize : Rules::reserveSize];
+    for (int i = 0; i < Rules::numPiles; ++i) {
+        for (int j = 0; j < Rules::pileSize; ++j) {
             // Reverse the order of cards in the pile
-            state.piles[i] |= static_cast<uint32_t>(deck[i * 5 + (4 - j)]) << (j * 4);
+            cards[j] = Rules::card(deck[i * Rules::pileSize + (Rules::pileSize - 1 - j)]);
         }
-        // Fill the remaining slots with 0x0F
-        state.piles[i] |= 0x0F << (5 * 4);
-        state.piles[i] |= 0x0F << (6 * 4);
-        state.piles[i] |= 0x0F << (7 * 4);
+        state.piles[i] = packCards<Rules, typename Rules::PileWord>(cards, Rules::pileSize);
     }
-    state.reserve = (static_cast<uint8_t>(deck[51]) & 0x0F) | ((static_cast<uint8_t>(deck[50]) & 0x0F) << 4);
+    for (int j = 0; j < Rules::reserveSize; ++j) {
+        cards[j] = Rules::card(deck[Rules::deckSize - 1 - j]);
+    }
+    state.reserve = packCards<Rules, typename Rules::ReserveWord>(cards, Rules::reserveSize);
     return state;
 }
 
+/* helper to shuffle the deck of deal `index` of a seeded run, as deck indices (0 .. deckSize - 1) in the order
+  createGameState and the deck files take them. Everything that deals from a seed goes through this, so deal i of
+  a seed is the same deal in main.cpp and corpusMiner.cpp */
+template <class Rules = StandardRules>
+void seededDeck(int deck[Rules::deckSize], uint64_t seed, uint64_t index) {
+    std::iota(deck, deck + Rules::deckSize, 0);
+    std::mt19937_64 g(mix64(seed ^ mix64(index)));
+    std::shuffle(deck, deck + Rules::deckSize, g);
+}
+
+/* Function to initialize the deal with the given index of a seeded run. The same seed and index always give the same
+  deal, whichever thread or shard deals it, so results can be tied back to deals without storing them */
+template <class Rules>
+void initializeGameStateFromSeed(BasicGameState<Rules>* state, uint64_t seed, uint64_t index) {
+    int deck[Rules::deckSize];
+    seededDeck<Rules>(deck, seed, index);
+    *state = createGameState<Rules>(deck);
+}
+
+// helper to read one line of a deck file into deck as ranks, returns false if the line has fewer than 52 cards.
+// Reading numbers rather than splitting on ' ' skips any whitespace, so trailing spaces and the \r of
+// files with Windows line endings don't end up as cards
+inline bool parseDeckLine(const std::string& line, int deck[52]) {
+    std::stringstream ss(line);
+    int card;
+    int index = 0;
+    while (index < 52 && ss >> card) {
+        deck[index++] = card % 13;
+    }
+    return index == 52;
+}
+
 // a function that takes a pointer to an array of GameStates,
 // and loads the game state array with states from a file of shuffled cards
 // A function to load the 5000 decks  from a file, each number representing a card is separated by a space and each deck is separated by a new line
-void loadDecksToStates(GameState* states, int size) {
-    std::ifstream infile("../BenchmarkGen/benchmarkDecks.txt");
+void loadDecksToStates(GameState* states, int size, const char* path = "../BenchmarkGen/benchmarkDecks.txt") {
+    std::ifstream infile(path);
     std::string line;
     int lines = 0;
     while (getline(infile, line) && lines < size) {
         int deck[52];
-        std::stringstream ss(line);
-        std::string card;
-        int index = 0;
-        while (std::getline (ss, card, ' ')) {
-            deck[index++] = std::stoi(card)%13;
-        }
+        if (!parseDeckLine(line, deck)) continue;
         states[lines] = createGameState(deck);
         lines++;
     }
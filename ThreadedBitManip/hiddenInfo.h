@@ -0,0 +1,243 @@
+#pragma once
+
+/* Win rate of a player who can't see under the top cards. The solvers know all 52 cards, a real player sees the top
+  card of each pile and of the reserve, how many cards are under each, and (by elimination) which cards those are
+  between them, but not where they are. This player plays by sampling: at every decision it deals the unseen cards
+  back into the unseen slots at random, solves each of those completions with every legal move, and plays the move
+  that wins in the most of them. The estimate is how often that player clears the board.
+  That is a lot of small solves, so:
+    - a decision point's completions are solved as a batch. Each one is solved as a whole first, and only if it can be
+      won are its moves checked one by one, and those are mostly answered by the positions the first search solved.
+    - completions that come out identical (common once few cards are hidden) share one set of answers. Sharing
+      positions between different completions doesn't pay: keyed on the full packed state, a table kept across them
+      matched almost nothing and was slower than starting each one clean.
+    - a completion is one deal, so its positions are solved with the hint engine's solveVerdict() in a HintMemo keyed
+      on stateKey() (see hintEngine.h). Each thread keeps one, reused for every completion of every deal, and its
+      generation reset clears it in O(1). It doubles if one completion's search fills it.
+  Each deal's sampling starts from a random state derived from the seed and the deal index, so a run with the same
+  seed plays the same moves whatever the thread count.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "solver.h"
+#include "playout.h"
+#include "hintEngine.h"
+#include "adaptive.h"
+
+// a thread's table starts with 64K positions (256 KB)
+const size_t HIDDEN_TABLE_BYTES = size_t(256) << 10;
+// deals a thread plays between two additions to the shared totals
+const int HIDDEN_CHUNK = 16;
+
+struct HiddenStats {
+    uint64_t games;
+    uint64_t wins;               // games the sampling player cleared
+    uint64_t solvable;           // games a player who sees every card could clear
+    uint64_t decisions;          // moves chosen by sampling
+    uint64_t forced;             // moves played without sampling, the only legal one
+    uint64_t completions;        // completions sampled
+    uint64_t duplicates;         // of those, ones identical to an earlier completion of the same decision
+    uint64_t lostCompletions;    // completions that couldn't be won at all, so their moves weren't checked
+    uint64_t nodes;              // positions searched
+    uint64_t tableHits;          // positions answered by the table
+};
+
+// a completion already solved at the current decision, and the moves that win it (bit m for move m)
+struct SolvedCompletion {
+    GameState state;
+    uint64_t winning;
+};
+
+// one thread's player: its table, the current decision's completions, its random state and its counters
+struct HiddenWorker {
+    HintMemo table;
+    vector<SolvedCompletion> solved;
+    uint64_t random;
+    HiddenStats stats;
+};
+
+// the thread's table as solveVerdict()'s memo, recording every position it finishes
+struct CompletionMemo {
+    HiddenWorker& worker;
+    int lookup(const GameState&, uint32_t key) {
+        int known = worker.table.lookup(key);
+        if (known >= 0) {
+            worker.stats.tableHits++;
+        } else {
+            worker.stats.nodes++;
+        }
+        return known;
+    }
+    void record(const GameState&, uint32_t key, bool won) {
+        if (worker.table.count >= worker.table.limit) worker.table.grow();
+        worker.table.record(key, won);
+    }
+};
+
+bool solveCompletion(GameState& state, HiddenWorker& worker) {
+    CompletionMemo memo = { worker };
+    return solveVerdict<false>(state, memo);
+}
+
+/* helper to deal the cards the player can't see back into the slots they can't see, at random. Writes the completion
+  and returns how many cards were hidden */
+int sampleCompletion(const GameState& seen, GameState& completion, uint64_t& random) {
+    uint8_t hidden[NUM_PILES * PILE_SIZE + RESERVE_SIZE];
+    int count = 0;
+    // every card under a top card, pile by pile, then the reserve
+    for (int i = 0; i <= NUM_PILES; ++i) {
+        uint32_t word = i < NUM_PILES ? seen.piles[i] : (0xFFFFFF00u | seen.reserve);
+        for (word >>= 4; (word & 0x0F) != 0x0F; word >>= 4) {
+            hidden[count++] = static_cast<uint8_t>(word & 0x0F);
+        }
+    }
+    for (int c = count - 1; c > 0; --c) {
+        swap(hidden[c], hidden[nextRandom(random) % (c + 1)]);
+    }
+    completion = seen;
+    int next = 0;
+    for (int i = 0; i <= NUM_PILES; ++i) {
+        uint32_t word = i < NUM_PILES ? seen.piles[i] : (0xFFFFFF00u | seen.reserve);
+        for (int d = 1; ((word >> (4 * d)) & 0x0F) != 0x0F; ++d) {
+            word = (word & ~(0x0Fu << (4 * d))) | (uint32_t(hidden[next++]) << (4 * d));
+        }
+        if (i < NUM_PILES) {
+            completion.piles[i] = word;
+        } else {
+            completion.reserve = static_cast<uint8_t>(word);
+        }
+    }
+    return count;
+}
+
+/* the sampling player's move from the true position, of the count legal ones in moves. Every completion is solved as a
+  whole first, and its moves are only checked if it can be won. Ties go to the first move in solve()'s order */
+int chooseMove(const GameState& truth, const PlayoutMove moves[], int count, int samples, HiddenWorker& worker) {
+    if (count == 1) {
+        worker.stats.forced++;
+        return 0;
+    }
+    worker.stats.decisions++;
+    worker.solved.clear();
+    int wins[MAX_MOVES] = {};
+    for (int s = 0; s < samples; ++s) {
+        GameState completion;
+        int hidden = sampleCompletion(truth, completion, worker.random);
+        worker.stats.completions++;
+        uint64_t winning = 0;
+        size_t match = 0;
+        while (match < worker.solved.size() && !(worker.solved[match].state == completion)) match++;
+        if (match < worker.solved.size()) {
+            worker.stats.duplicates++;
+            winning = worker.solved[match].winning;
+        } else {
+            worker.table.reset();
+            GameState whole = completion;
+            if (!solveCompletion(whole, worker)) {
+                worker.stats.lostCompletions++;
+            } else {
+                for (int m = 0; m < count; ++m) {
+                    GameState child = completion;
+                    applyMove(child, moves[m]);
+                    if (solveCompletion(child, worker)) winning |= uint64_t(1) << m;
+                }
+            }
+            worker.solved.push_back(SolvedCompletion{ completion, winning });
+        }
+        for (int m = 0; m < count; ++m) {
+            wins[m] += (winning >> m) & 1;
+        }
+        // with nothing hidden every completion is the true position
+        if (!hidden) break;
+    }
+    int best = 0;
+    for (int m = 1; m < count; ++m) {
+        if (wins[m] > wins[best]) best = m;
+    }
+    return best;
+}
+
+// plays one deal as the sampling player, returns true if it clears the board
+bool playHidden(GameState truth, int samples, HiddenWorker& worker) {
+    PlayoutMove moves[MAX_MOVES];
+    for (;;) {
+        int count = listMoves(truth, moves);
+        if (!count) break;
+        applyMove(truth, moves[chooseMove(truth, moves, count, samples, worker)]);
+    }
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (truth.piles[i] != 0xFFFFFFFFu) return false;
+    }
+    return getTopReserveCard(&truth) == 15;
+}
+
+void addHiddenStats(HiddenStats& into, const HiddenStats& from) {
+    into.games += from.games;
+    into.wins += from.wins;
+    into.solvable += from.solvable;
+    into.decisions += from.decisions;
+    into.forced += from.forced;
+    into.completions += from.completions;
+    into.duplicates += from.duplicates;
+    into.lostCompletions += from.lostCompletions;
+    into.nodes += from.nodes;
+    into.tableHits += from.tableHits;
+}
+
+/* plays numGames deals dealt from seed (deal i is initializeGameStateFromSeed(seed, i)) on numThreads threads with
+  samples completions per decision. Every deal is also solved with all cards known, for comparison */
+HiddenStats estimateHiddenWinRate(uint64_t numGames, int samples, int numThreads, uint64_t seed) {
+    HiddenStats total = HiddenStats();
+    mutex mtx;
+    atomic<uint64_t> nextDeal(0);
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&] {
+            HiddenWorker worker;
+            worker.table.init(HIDDEN_TABLE_BYTES);
+            worker.stats = HiddenStats();
+            for (;;) {
+                uint64_t first = nextDeal.fetch_add(HIDDEN_CHUNK);
+                if (first >= numGames) break;
+                uint64_t last = min(first + HIDDEN_CHUNK, numGames);
+                for (uint64_t d = first; d < last; ++d) {
+                    GameState deal;
+                    initializeGameStateFromSeed(&deal, seed, d);
+                    // one more mixing round than the deal's own seed, so the sampling doesn't follow the shuffle
+                    worker.random = mix64(mix64(seed ^ mix64(d)));
+                    worker.table.reset();
+                    worker.stats.games++;
+                    GameState whole = deal;
+                    if (hasThreeJacks(&whole) || !solveCompletion(whole, worker)) continue;
+                    worker.stats.solvable++;
+                    worker.stats.wins += playHidden(deal, samples, worker);
+                }
+            }
+            lock_guard<mutex> lock(mtx);
+            addHiddenStats(total, worker.stats);
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    return total;
+}
+
+void printHiddenStats(const HiddenStats& stats, int samples, double confidence) {
+    double z = zForConfidence(confidence);
+    WilsonInterval hidden = wilsonInterval(stats.wins, stats.games, z);
+    WilsonInterval known = wilsonInterval(stats.solvable, stats.games, z);
+    cout << "Games: " << stats.games << ", " << samples << " sampled completions per decision" << endl;
+    cout << "Won seeing only the top cards: " << stats.wins << " (" << 100.0 * stats.wins / max<uint64_t>(stats.games, 1) << "%, "
+        << 100 * confidence << "% interval [" << 100 * hidden.low << "%, " << 100 * hidden.high << "%])" << endl;
+    cout << "Solvable seeing every card: " << stats.solvable << " (" << 100.0 * stats.solvable / max<uint64_t>(stats.games, 1) << "%, "
+        << 100 * confidence << "% interval [" << 100 * known.low << "%, " << 100 * known.high << "%])" << endl;
+    cout << "Decisions: " << stats.decisions << " sampled, " << stats.forced << " forced. Completions: " << stats.completions
+        << ", " << stats.duplicates << " repeats of an earlier one, " << stats.lostCompletions << " lost outright" << endl;
+    cout << "Positions searched: " << stats.nodes << ", answered by the table: " << stats.tableHits << endl;
+}
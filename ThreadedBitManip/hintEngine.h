@@ -0,0 +1,348 @@
+#pragma once
+
+/* Hints for a game in progress: every move from the player's position that keeps the game winnable.
+  A HintSession belongs to one game. It holds the deal, the moves played so far and a memo of every position it has
+  solved. Within one deal a position is fixed by how deep each pile and the reserve are, so the memo is keyed on
+  stateKey() and stores a won or lost bit per position.
+  The search is solveVerdict(), solve()'s moves with the memo as its visited set. The positions form a DAG (every move takes two cards away),
+  so once a search returns, every position it expanded has a final answer. The winning line is recorded as won and
+  the rest as lost. The player's next position is one of the children the last query already solved, so most
+  follow-up queries are a handful of memo lookups.
+  The memo is a fixed block, sized when the session starts. A search depends on every verdict it has recorded (the memo
+  is its visited set), so nothing is evicted while one runs: once the memo is full, the rest of that query's verdicts
+  go to an overflow table that is freed when the query returns. The next query makes room first. Positions with more
+  cards than the player's position are evicted first, because cards never come back so those can't be reached again.
+  If that isn't enough, lost positions go too, nearest the end of the game first. Ending the session frees the block.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "solver.h"
+
+// default memo size per session, 4M positions
+const size_t HINT_MEMO_BYTES = size_t(16) << 20;
+// a query's overflow table starts with 64K positions and doubles as needed
+const size_t HINT_OVERFLOW_BYTES = size_t(256) << 10;
+
+// helper to get the cards left in the position a stateKey() stands for
+inline int cardsLeftOfKey(uint32_t key) {
+    int removed = 0;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        removed += key % 6;
+        key /= 6;
+    }
+    return NUM_PILES * PILE_SIZE + RESERVE_SIZE - removed - static_cast<int>(key);
+}
+
+/* solved positions of one deal. Slots hold generation << 29 | (key + 1) << 1 | won, stateKey() is below 2^28 so the
+  top three bits are free for the generation. Entries of an older generation count as empty, so reset() forgets every
+  position in O(1), and only every seventh reset clears the block (generation 0 is never live, a zeroed slot is empty) */
+struct HintMemo {
+    static const int GENERATION_SHIFT = 29;
+    static const uint32_t GENERATIONS = 7;
+    vector<uint32_t> slots;
+    uint32_t mask;
+    int shift;
+    uint32_t count;
+    uint32_t limit;
+    uint32_t generation;
+
+    void init(size_t bytes) {
+        int log2 = 10;
+        while ((size_t(4) << (log2 + 1)) <= bytes && log2 < 30) log2++;
+        slots.assign(size_t(1) << log2, 0);
+        mask = (uint32_t(1) << log2) - 1;
+        shift = 32 - log2;
+        count = 0;
+        limit = mask / 4 * 3;
+        generation = 1;
+    }
+
+    void release() {
+        vector<uint32_t>().swap(slots);
+        count = 0;
+        limit = 0;
+    }
+
+    // forgets every position, for the next deal
+    void reset() {
+        count = 0;
+        if (++generation > GENERATIONS) {
+            fill(slots.begin(), slots.end(), 0);
+            generation = 1;
+        }
+    }
+
+    inline bool live(uint32_t entry) const {
+        return (entry >> GENERATION_SHIFT) == generation;
+    }
+
+    static inline uint32_t keyOf(uint32_t entry) {
+        return ((entry >> 1) & ((uint32_t(1) << (GENERATION_SHIFT - 1)) - 1)) - 1;
+    }
+
+    inline uint32_t slotFor(uint32_t key) const {
+        return (key * 0x9E3779B1u) >> shift;
+    }
+
+    // 1 if the position is won, 0 if it is lost, -1 if it hasn't been solved
+    int lookup(uint32_t key) const {
+        for (uint32_t slot = slotFor(key);; slot = (slot + 1) & mask) {
+            uint32_t entry = slots[slot];
+            if (!live(entry)) return -1;
+            if (keyOf(entry) == key) return static_cast<int>(entry & 1);
+        }
+    }
+
+    // records a position, the caller evicts or grows first if count has reached limit
+    void record(uint32_t key, bool won) {
+        const uint32_t entry = (generation << GENERATION_SHIFT) | ((key + 1) << 1) | (won ? 1u : 0u);
+        uint32_t slot = slotFor(key);
+        while (live(slots[slot]) && keyOf(slots[slot]) != key) slot = (slot + 1) & mask;
+        count += !live(slots[slot]);
+        slots[slot] = entry;
+    }
+
+    // doubles the table, for memos that aren't bounded (see deltaSolve.h and hiddenInfo.h)
+    void grow() {
+        vector<uint32_t> old;
+        old.swap(slots);
+        const uint32_t current = generation;
+        init(old.size() * 2 * sizeof(uint32_t));
+        for (uint32_t entry : old) {
+            if ((entry >> GENERATION_SHIFT) == current) record(keyOf(entry), entry & 1);
+        }
+    }
+
+    // rebuilds the table with only the positions keep() accepts, returns how many were dropped
+    template <class Keep>
+    uint32_t retain(Keep keep) {
+        vector<uint32_t> old(slots.size(), 0);
+        old.swap(slots);
+        uint32_t before = count;
+        count = 0;
+        for (uint32_t entry : old) {
+            if (live(entry) && keep(entry)) record(keyOf(entry), entry & 1);
+        }
+        return before - count;
+    }
+};
+
+/* The verdict search the hint engine, delta solving (deltaSolve.h) and the hidden information player (hiddenInfo.h)
+  share: solve()'s moves in its order, with a memo in place of the visited set. memo.lookup(state, key) gives 1 for
+  won, 0 for lost or -1 to search the position, and memo.record(state, key, won) gets the verdict of every position
+  searched. A search normally stops at a position's first winning move. Exhaustive tries every move, so every
+  position reached gets its verdict */
+template <bool Exhaustive, class Memo>
+bool solveVerdict(GameState& state, Memo& memo) {
+    bool allEmpty = true;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (getTopPileCard(&state, i) != 15) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == 15) return true;
+
+    uint32_t key = stateKey(state);
+    int known = memo.lookup(state, key);
+    if (known >= 0) return known == 1;
+    bool won = false;
+    for (int i = 0; i < NUM_PILES && (Exhaustive || !won); ++i) {
+        int topCard1 = getTopPileCard(&state, i);
+        if (topCard1 == 15) continue;
+        for (int j = i + 1; j < NUM_PILES && (Exhaustive || !won); ++j) {
+            int topCard2 = getTopPileCard(&state, j);
+            if (topCard2 != 15 && isPair(topCard1, topCard2)) {
+                int card1 = removeTopPileCard(&state, i);
+                int card2 = removeTopPileCard(&state, j);
+                won |= solveVerdict<Exhaustive>(state, memo);
+                addPileCard(&state, i, card1);
+                addPileCard(&state, j, card2);
+            }
+        }
+    }
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve != 15) {
+        for (int i = 0; i < NUM_PILES && (Exhaustive || !won); ++i) {
+            int topCard = getTopPileCard(&state, i);
+            if (topCard != 15 && isPair(topReserve, topCard)) {
+                int card = removeTopPileCard(&state, i);
+                int reserve = removeTopReserveCard(&state);
+                won |= solveVerdict<Exhaustive>(state, memo);
+                addPileCard(&state, i, card);
+                addReserveCard(&state, reserve);
+            }
+        }
+    }
+    memo.record(state, key, won);
+    return won;
+}
+
+struct HintStats {
+    uint64_t queries;
+    uint64_t nodes;          // positions searched, each one a memo miss
+    uint64_t memoHits;       // positions answered from the memo
+    uint64_t evicted;        // positions dropped to make room
+    uint64_t overflowed;     // positions a full memo couldn't take, kept until the end of their query
+    int64_t lastQueryNanos;
+};
+
+class HintSession {
+public:
+    explicit HintSession(const GameState& deal, size_t memoBytes = HINT_MEMO_BYTES) : deal(deal), current(deal), memoSize(memoBytes), stats() {
+        memo.init(memoSize);
+    }
+
+    // goes back to the deal, the memo stays since it is the same game
+    void restart() {
+        current = deal;
+        played.clear();
+    }
+
+    // plays a move from the current position, returns false (and plays nothing) if it isn't legal
+    bool play(const PlayoutMove& move) {
+        if (move.a < 0 || move.a >= NUM_PILES || move.b <= move.a || move.b > NUM_PILES) return false;
+        int topCard1 = getTopPileCard(&current, move.a);
+        int topCard2 = move.b < NUM_PILES ? getTopPileCard(&current, move.b) : getTopReserveCard(&current);
+        if (topCard1 == 15 || topCard2 == 15 || !isPair(topCard1, topCard2)) return false;
+        applyMove(current, move);
+        played.push_back(move);
+        return true;
+    }
+
+    /* moves to the position after the given moves from the deal. If they extend the moves already played only the
+      new ones are played. Returns false if one of them isn't legal, the session is then at the deal */
+    bool setPosition(const vector<PlayoutMove>& moves) {
+        bool extends = moves.size() >= played.size();
+        for (size_t m = 0; extends && m < played.size(); ++m) {
+            extends = moves[m].a == played[m].a && moves[m].b == played[m].b;
+        }
+        if (!extends) restart();
+        for (size_t m = played.size(); m < moves.size(); ++m) {
+            if (!play(moves[m])) {
+                restart();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // every legal move from the current position that keeps the game winnable, in solve()'s order
+    vector<PlayoutMove> winningMoves() {
+        auto start = chrono::steady_clock::now();
+        vector<PlayoutMove> winning;
+        if (!hasThreeJacks(&current)) {
+            startQuery();
+            PlayoutMove moves[MAX_MOVES];
+            int count = listMoves(current, moves);
+            for (int m = 0; m < count; ++m) {
+                GameState child = current;
+                applyMove(child, moves[m]);
+                if (solvePosition(child)) winning.push_back(moves[m]);
+            }
+            finishQuery();
+        }
+        stats.queries++;
+        stats.lastQueryNanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        return winning;
+    }
+
+    // true if the game can still be won from the current position
+    bool winnable() {
+        GameState position = current;
+        if (hasThreeJacks(&position)) return false;
+        startQuery();
+        bool won = solvePosition(position);
+        finishQuery();
+        return won;
+    }
+
+    // ends the session, freeing the memo. A later query starts an empty one
+    void end() {
+        memo.release();
+    }
+
+    const GameState& position() const { return current; }
+    const vector<PlayoutMove>& movesPlayed() const { return played; }
+    size_t memoPositions() const { return memo.count; }
+    size_t memoBytes() const { return memo.slots.size() * sizeof(uint32_t); }
+    const HintStats& statistics() const { return stats; }
+
+private:
+    // the memo side of solveVerdict()
+    struct SessionMemo {
+        HintSession& session;
+        int lookup(const GameState&, uint32_t key) {
+            int known = session.memo.lookup(key);
+            if (known < 0 && !session.overflow.slots.empty()) known = session.overflow.lookup(key);
+            if (known >= 0) {
+                session.stats.memoHits++;
+            } else {
+                session.stats.nodes++;
+            }
+            return known;
+        }
+        void record(const GameState&, uint32_t key, bool won) {
+            if (session.memo.count < session.memo.limit) {
+                session.memo.record(key, won);
+                return;
+            }
+            HintMemo& overflow = session.overflow;
+            if (overflow.slots.empty()) overflow.init(HINT_OVERFLOW_BYTES);
+            if (overflow.count >= overflow.limit) overflow.grow();
+            overflow.record(key, won);
+            session.stats.overflowed++;
+        }
+    };
+
+    // makes room in a full memo before a query's searches start, never during them
+    void startQuery() {
+        if (memo.slots.empty()) memo.init(memoSize);
+        if (memo.count >= memo.limit) evict();
+    }
+
+    // frees the overflow table once the query's searches are done
+    void finishQuery() {
+        if (!overflow.slots.empty()) overflow.release();
+    }
+
+    bool solvePosition(GameState& state) {
+        SessionMemo policy = { *this };
+        return solveVerdict<false>(state, policy);
+    }
+
+    /* makes room in the memo. First the positions behind the player go. If it is still over half full, lost positions
+      go next, the ones with the fewest cards first since their searches are the cheapest to redo, until it is half
+      full. Everything goes if even that isn't enough */
+    void evict() {
+        const int horizon = cardsLeftOfKey(stateKey(current));
+        stats.evicted += memo.retain([horizon](uint32_t entry) { return cardsLeftOfKey(HintMemo::keyOf(entry)) <= horizon; });
+        if (memo.count > memo.limit / 2) {
+            const int NUM_CARDS = NUM_PILES * PILE_SIZE + RESERVE_SIZE;
+            uint32_t lostByCards[NUM_CARDS + 1] = {};
+            for (uint32_t entry : memo.slots) {
+                if (memo.live(entry) && !(entry & 1)) lostByCards[cardsLeftOfKey(HintMemo::keyOf(entry))]++;
+            }
+            int cutoff = -1;
+            for (uint32_t freed = 0; cutoff < NUM_CARDS && memo.count - freed > memo.limit / 2;) {
+                freed += lostByCards[++cutoff];
+            }
+            stats.evicted += memo.retain([cutoff](uint32_t entry) { return (entry & 1) || cardsLeftOfKey(HintMemo::keyOf(entry)) > cutoff; });
+        }
+        if (memo.count > memo.limit / 2) {
+            stats.evicted += memo.retain([](uint32_t) { return false; });
+        }
+    }
+
+    GameState deal;
+    GameState current;
+    vector<PlayoutMove> played;
+    HintMemo memo;
+    HintMemo overflow;
+    size_t memoSize;
+    HintStats stats;
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+/* Interleaved solving: one thread keeps `width` deals in flight. Each deal is an explicit stack search (the same moves
+  in the same order as solve()) that can stop and resume at a visited set probe. When a deal reaches a new state it
+  works out the state's slot in its visited table, prefetches it and hands over to the next deal, and the probe is only
+  done the next time round, once the cache line has (hopefully) arrived. So instead of stalling on every table miss,
+  the thread has up to `width` misses outstanding at once.
+  Each deal in flight has its own open addressing table keyed on stateKey(), tagged with a generation like
+  ConcurrentVisitedSet (see parallelSolver.h), so starting the next deal in a lane doesn't clear anything.
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "solver.h"
+
+#if defined(_MSC_VER) || defined(__SSE__)
+#include <xmmintrin.h>
+#define PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#define PREFETCH(address) __builtin_prefetch(address)
+#endif
+
+// a lane's table starts with 64K slots (512 KB) and doubles whenever it gets half full
+const int LANE_TABLE_LOG2 = 16;
+// moves in the longest game (every card paired) plus the starting state
+const int MAX_SEARCH_DEPTH = (NUM_PILES * PILE_SIZE + RESERVE_SIZE) / 2 + 1;
+
+// visited set for one lane, single threaded. Slots hold (generation << 32 | key + 1)
+struct LaneTable {
+    vector<uint64_t> slots;
+    uint32_t mask;
+    int shift;
+    uint64_t generation;
+    uint32_t count;
+
+    void init(int capacityLog2) {
+        slots.assign(size_t(1) << capacityLog2, 0);
+        mask = (uint32_t(1) << capacityLog2) - 1;
+        shift = 32 - capacityLog2;
+        generation = 1;
+        count = 0;
+    }
+
+    void reset() {
+        generation++;
+        count = 0;
+    }
+
+    inline uint32_t slotFor(uint32_t key) const {
+        return (key * 0x9E3779B1u) >> shift;
+    }
+
+    // returns true if the key was not in the set (and is now), probing from slot
+    bool insertAt(uint32_t key, uint32_t slot) {
+        const uint64_t entry = (generation << 32) | (uint64_t(key) + 1);
+        for (;; slot = (slot + 1) & mask) {
+            uint64_t current = slots[slot];
+            if (current == entry) return false;
+            if ((current >> 32) != generation) {
+                slots[slot] = entry;
+                if (++count * 2 > mask) grow();
+                return true;
+            }
+        }
+    }
+
+    // doubles the table, keeping this generation's keys
+    void grow() {
+        vector<uint64_t> old;
+        old.swap(slots);
+        const uint64_t current = generation;
+        init(32 - shift + 1);
+        generation = current;
+        for (uint64_t entry : old) {
+            if ((entry >> 32) != generation) continue;
+            uint32_t key = uint32_t(entry) - 1;
+            uint32_t slot = slotFor(key);
+            while (slots[slot]) slot = (slot + 1) & mask;
+            slots[slot] = entry;
+            count++;
+        }
+    }
+};
+
+// one state on a lane's stack and where its move loops are up to. i and j run over the pile pairs, then r over the piles for the reserve
+struct SearchFrame {
+    GameState state;
+    int8_t i;
+    int8_t j;
+    int8_t r;
+};
+
+// one deal in flight
+struct Lane {
+    SearchFrame stack[MAX_SEARCH_DEPTH];
+    int depth;
+    uint32_t key;
+    uint32_t slot;
+    uint64_t deal;
+    bool active;
+    LaneTable table;
+};
+
+// helper to make the next child of a frame, in solve()'s move order. Returns false once every move has been tried
+inline bool nextChild(SearchFrame& frame, GameState& child) {
+    GameState& state = frame.state;
+    for (; frame.i < NUM_PILES; frame.i++, frame.j = frame.i) {
+        int topCard1 = getTopPileCard(&state, frame.i);
+        if (topCard1 == 15) continue;
+        while (++frame.j < NUM_PILES) {
+            int topCard2 = getTopPileCard(&state, frame.j);
+            if (topCard2 != 15 && isPair(topCard1, topCard2)) {
+                child = state;
+                removeTopPileCard(&child, frame.i);
+                removeTopPileCard(&child, frame.j);
+                return true;
+            }
+        }
+    }
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve == 15) return false;
+    while (frame.r < NUM_PILES) {
+        int pile = frame.r++;
+        int topCard = getTopPileCard(&state, pile);
+        if (topCard != 15 && isPair(topReserve, topCard)) {
+            child = state;
+            removeTopPileCard(&child, pile);
+            removeTopReserveCard(&child);
+            return true;
+        }
+    }
+    return false;
+}
+
+class InterleavedSolver {
+public:
+    explicit InterleavedSolver(int width) : lanes(width > 0 ? width : 1), nodes(0) {
+        for (Lane& lane : lanes) {
+            lane.table.init(LANE_TABLE_LOG2);
+            lane.active = false;
+        }
+    }
+
+    /* solves deals 0 to count - 1. getDeal(i, state) fills in deal i and onResult(i, solvable) is called as each one
+      finishes, roughly but not exactly in deal order */
+    template <class GetDeal, class OnResult>
+    void run(uint64_t count, GetDeal getDeal, OnResult onResult) {
+        uint64_t next = 0;
+        size_t inFlight = 0;
+        for (;;) {
+            for (Lane& lane : lanes) {
+                // fill an idle lane, deals that are settled without a search are reported straight away
+                while (!lane.active && next < count) {
+                    lane.deal = next++;
+                    GameState& state = lane.stack[0].state;
+                    getDeal(lane.deal, state);
+                    if (hasThreeJacks(&state)) {
+                        onResult(lane.deal, false);
+                        continue;
+                    }
+                    lane.table.reset();
+                    lane.depth = 1;
+                    lane.active = true;
+                    inFlight++;
+                    if (enterNode(lane)) {
+                        finish(lane, true, onResult);
+                        inFlight--;
+                    }
+                }
+                if (!lane.active) continue;
+                int result = resume(lane);
+                if (result >= 0) {
+                    finish(lane, result == 1, onResult);
+                    inFlight--;
+                }
+            }
+            if (!inFlight && next >= count) return;
+        }
+    }
+
+    uint64_t nodesExpanded() const { return nodes; }
+
+private:
+    // starts the top frame of a lane: true if it is the solved board, otherwise its table slot is prefetched for resume()
+    bool enterNode(Lane& lane) {
+        SearchFrame& frame = lane.stack[lane.depth - 1];
+        bool allEmpty = true;
+        for (int i = 0; i < NUM_PILES; ++i) {
+            if (getTopPileCard(&frame.state, i) != 15) {
+                allEmpty = false;
+                break;
+            }
+        }
+        if (allEmpty && getTopReserveCard(&frame.state) == 15) return true;
+        lane.key = stateKey(frame.state);
+        lane.slot = lane.table.slotFor(lane.key);
+        PREFETCH(&lane.table.slots[lane.slot]);
+        return false;
+    }
+
+    /* does the pending probe of a lane and searches on until the next probe is set up.
+      Returns -1 if the deal is still running, 1 if it is solvable, 0 if not */
+    int resume(Lane& lane) {
+        bool expand = lane.table.insertAt(lane.key, lane.slot);
+        if (expand) {
+            nodes++;
+            SearchFrame& frame = lane.stack[lane.depth - 1];
+            frame.i = 0;
+            frame.j = 0;
+            frame.r = 0;
+        } else {
+            lane.depth--;
+        }
+        while (lane.depth > 0) {
+            SearchFrame& frame = lane.stack[lane.depth - 1];
+            if (nextChild(frame, lane.stack[lane.depth].state)) {
+                lane.depth++;
+                return enterNode(lane) ? 1 : -1;
+            }
+            lane.depth--;
+        }
+        return 0;
+    }
+
+    template <class OnResult>
+    void finish(Lane& lane, bool solvable, OnResult& onResult) {
+        lane.active = false;
+        onResult(lane.deal, solvable);
+    }
+
+    vector<Lane> lanes;
+    uint64_t nodes;
+};
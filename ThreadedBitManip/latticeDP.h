@@ -0,0 +1,230 @@
+#pragma once
+
+/* Solvability as a DP over the pile depth lattice. A state of a deal is a tuple of cards gone per pile (0-5) and from
+  the reserve (0-2), packed by stateKey() into a key below 3 * 6^10, and every move adds to the key, so ascending key
+  order is a topological order of the state graph. Two sweeps over a dense bit array of all 181M keys (22 MB):
+    - forward: starting from the deal, take the marked keys in ascending order and mark their successors. Every state
+      is taken after all its predecessors, so when the sweep ends the marks are exactly the reachable states.
+    - backward: go through the reachable states in descending order and mark a state "good" if it is the goal or one of
+      its successors is good. The deal is solvable exactly if it is good.
+  No recursion and no hashing. Finding the next marked key skips empty space with two summary levels (a bit per
+  non-empty word, and a bit per non-empty summary word), so a sweep costs about the number of reachable states, not
+  the size of the lattice. Only the words that were touched are cleared for the next deal.
+  If the forward sweep never marks the goal the backward sweep is skipped, nothing can reach it.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "bidirectional.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// keys run below 3 * 6^10
+const uint32_t LATTICE_SIZE = 181398528u;
+
+// helper to get the index of the lowest set bit of a nonzero word
+inline int lowestBit(uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// statistics of one deal, and sums of them
+struct LatticeStats {
+    uint64_t reachable;   // states the forward sweep marked, solve()'s visited set size for an unsolvable deal
+    uint64_t good;        // reachable states that can still be cleared
+    uint64_t forwardNanos;
+    uint64_t backwardNanos;
+};
+
+// the bit arrays, allocated once per thread and reused for every deal
+struct DepthLattice {
+    vector<uint64_t> reach;    // one bit per key
+    vector<uint64_t> summary;  // bit w: reach word w is non-empty
+    vector<uint64_t> top;      // bit s: summary word s is non-empty
+    vector<uint64_t> good;     // one bit per key, the backward sweep's result
+    vector<uint32_t> order;    // the reachable keys in ascending order
+    vector<uint32_t> edgeStart;
+    vector<uint32_t> edges;
+
+    DepthLattice() : reach(LATTICE_SIZE / 64 + 1, 0), summary(reach.size() / 64 + 1, 0), top(summary.size() / 64 + 1, 0),
+        good(reach.size(), 0) {}
+
+    inline void mark(uint32_t key) {
+        uint32_t word = key >> 6;
+        if (!reach[word]) {
+            summary[word >> 6] |= uint64_t(1) << (word & 63);
+            top[word >> 12] |= uint64_t(1) << ((word >> 6) & 63);
+        }
+        reach[word] |= uint64_t(1) << (key & 63);
+    }
+
+    inline bool isGood(uint32_t key) const {
+        return (good[key >> 6] >> (key & 63)) & 1;
+    }
+
+    // the smallest marked key >= key, or LATTICE_SIZE if there is none
+    uint32_t nextMarked(uint32_t key) const {
+        uint32_t word = key >> 6;
+        uint64_t bits = reach[word] & (~uint64_t(0) << (key & 63));
+        if (bits) return (word << 6) | lowestBit(bits);
+        // the next non-empty word after this one, from the summary, then from the top level
+        uint32_t next = word + 1;
+        uint32_t s = next >> 6;
+        bits = (next & 63) ? summary[s] & (~uint64_t(0) << (next & 63)) : summary[s];
+        if (!bits) {
+            uint32_t nextSummary = s + 1;
+            uint32_t t = nextSummary >> 6;
+            uint64_t topBits = (nextSummary & 63) ? top[t] & (~uint64_t(0) << (nextSummary & 63)) : top[t];
+            while (!topBits) {
+                if (++t >= top.size()) return LATTICE_SIZE;
+                topBits = top[t];
+            }
+            s = (t << 6) | lowestBit(topBits);
+            bits = summary[s];
+        }
+        word = (s << 6) | lowestBit(bits);
+        return (word << 6) | lowestBit(reach[word]);
+    }
+
+    // clears every word the last deal touched
+    void clear() {
+        for (uint32_t key : order) {
+            uint32_t word = key >> 6;
+            reach[word] = 0;
+            good[word] = 0;
+            summary[word >> 6] = 0;
+            top[word >> 12] = 0;
+        }
+        order.clear();
+        edgeStart.clear();
+        edges.clear();
+    }
+};
+
+// a deal laid out for the sweeps: cards by depth with an empty card below the last one, and which cards pair
+struct LatticeLayout {
+    uint8_t pileCards[NUM_PILES][PILE_SIZE + 1];  // [pile][depth], depth PILE_SIZE is the empty card 15
+    uint8_t reserveCards[RESERVE_SIZE + 1];
+    uint32_t weights[NUM_PILES + 1];              // the reserve's weight last
+    uint16_t partners[16];                        // bit c of partners[a]: a pairs with c. Nothing pairs with 15
+};
+
+void initLatticeLayout(LatticeLayout& layout, const GameState& deal) {
+    DealLayout cards;
+    initDealLayout(cards, deal);
+    for (int i = 0; i < NUM_PILES; ++i) {
+        for (int d = 0; d < PILE_SIZE; ++d) {
+            layout.pileCards[i][d] = static_cast<uint8_t>(cards.pileCards[i][d]);
+        }
+        layout.pileCards[i][PILE_SIZE] = 15;
+        layout.weights[i] = cards.weights[i];
+    }
+    for (int d = 0; d < RESERVE_SIZE; ++d) {
+        layout.reserveCards[d] = static_cast<uint8_t>(cards.reserveCards[d]);
+    }
+    layout.reserveCards[RESERVE_SIZE] = 15;
+    layout.weights[NUM_PILES] = cards.reserveWeight;
+    for (int a = 0; a < 16; ++a) {
+        layout.partners[a] = 0;
+        for (int c = 0; c < 15 && a < 15; ++c) {
+            if (isPair(a, c)) layout.partners[a] |= 1 << c;
+        }
+    }
+}
+
+/* appends the states one move on from key, in no particular order. The piles (and the reserve, as slot NUM_PILES) are
+  bucketed by top card, then each pile's partners are the buckets of the cards it pairs with, a mask of later slots.
+  No branch per pair of piles, and the loops over the slots have fixed trip counts */
+inline void latticeSuccessors(const LatticeLayout& layout, uint32_t key, vector<uint32_t>& next) {
+    int removed[NUM_PILES], reserveRemoved;
+    keyDepths(key, removed, reserveRemoved);
+    uint8_t tops[NUM_PILES + 1];
+    for (int i = 0; i < NUM_PILES; ++i) {
+        tops[i] = layout.pileCards[i][removed[i]];
+    }
+    tops[NUM_PILES] = layout.reserveCards[reserveRemoved];
+    uint16_t byCard[16] = {};
+    for (int i = 0; i <= NUM_PILES; ++i) {
+        byCard[tops[i]] |= 1 << i;
+    }
+    for (int i = 0; i < NUM_PILES; ++i) {
+        uint32_t cards = layout.partners[tops[i]];
+        uint32_t slots = 0;
+        while (cards) {
+            int c = lowestBit(cards);
+            cards &= cards - 1;
+            slots |= byCard[c];
+        }
+        slots &= ~((2u << i) - 1);  // only later slots, so each pair is made once
+        while (slots) {
+            int j = lowestBit(slots);
+            slots &= slots - 1;
+            next.push_back(key + layout.weights[i] + layout.weights[j]);
+        }
+    }
+}
+
+/* returns true if the deal can be cleared. After it returns, lattice.order holds the reachable states and isGood()
+  says which of them can still be cleared (until the next call) */
+bool solveLattice(const GameState& deal, DepthLattice& lattice, LatticeStats* stats = nullptr) {
+    lattice.clear();
+    LatticeLayout layout;
+    initLatticeLayout(layout, deal);
+    const uint32_t goal = layout.weights[NUM_PILES] * (RESERVE_SIZE + 1) - 1;
+
+    // the successors of state k are edges[edgeStart[k] .. edgeStart[k + 1]), kept for the backward sweep
+    auto start = chrono::steady_clock::now();
+    lattice.mark(stateKey(deal));
+    for (uint32_t key = lattice.nextMarked(stateKey(deal)); key < LATTICE_SIZE; key = lattice.nextMarked(key + 1)) {
+        lattice.order.push_back(key);
+        lattice.edgeStart.push_back(static_cast<uint32_t>(lattice.edges.size()));
+        size_t first = lattice.edges.size();
+        latticeSuccessors(layout, key, lattice.edges);
+        for (size_t e = first; e < lattice.edges.size(); ++e) {
+            lattice.mark(lattice.edges[e]);
+        }
+    }
+    lattice.edgeStart.push_back(static_cast<uint32_t>(lattice.edges.size()));
+    auto forwardEnd = chrono::steady_clock::now();
+
+    // a state is good if any successor is: an OR over its edges, no early exit
+    uint64_t good = 0;
+    if (lattice.order.back() == goal) {
+        const uint32_t* edges = lattice.edges.data();
+        for (size_t k = lattice.order.size(); k-- > 0;) {
+            uint32_t key = lattice.order[k];
+            uint64_t canClear = key == goal;
+            for (uint32_t e = lattice.edgeStart[k]; e < lattice.edgeStart[k + 1]; ++e) {
+                canClear |= lattice.good[edges[e] >> 6] >> (edges[e] & 63);
+            }
+            canClear &= 1;
+            lattice.good[key >> 6] |= canClear << (key & 63);
+            good += canClear;
+        }
+    }
+    if (stats) {
+        auto backwardEnd = chrono::steady_clock::now();
+        stats->reachable += lattice.order.size();
+        stats->good += good;
+        stats->forwardNanos += chrono::duration_cast<chrono::nanoseconds>(forwardEnd - start).count();
+        stats->backwardNanos += chrono::duration_cast<chrono::nanoseconds>(backwardEnd - forwardEnd).count();
+    }
+    return lattice.isGood(lattice.order.front());
+}
+
+// function which checks to see if a state is solvable with the lattice DP, adding its counts to stats
+bool isSolvableLattice(GameState* state, DepthLattice& lattice, LatticeStats* stats = nullptr) {
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    return solveLattice(*state, lattice, stats);
+}
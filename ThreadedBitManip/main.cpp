@@ -16,8 +16,6 @@ Total time: 49292 milliseconds.
 AKA: 1 million random games evaluated in 50 seconds.
 */
 
-#pragma once
-
 #include <iostream>
 #include <iomanip>
 #include <array>
@@ -29,128 +27,420 @@ AKA: 1 million random games evaluated in 50 seconds.
 #include <chrono>
 #include <mutex>
 #include <thread>
+#include <memory>
 
 #include "gameState.h"
 #include "print.h"
 #include "solver.h"
+#include "parallelSolver.h"
+#include "budget.h"
+#include "adaptive.h"
+#include "nogood.h"
+#include "numa.h"
+#include "perfCounters.h"
+#include "outcomeFile.h"
+#include "phaseProfile.h"
+#include "trace.h"
+#include "interleave.h"
+#include "playout.h"
+#include "bidirectional.h"
+#include "frontier.h"
+#include "latticeDP.h"
+#include "portfolio.h"
+#include "partialOrder.h"
+#include "symmetry.h"
+#include "deadState.h"
+#include "cpuDispatch.h"
+#include "deltaSolve.h"
+#include "hiddenInfo.h"
 
 using namespace std;
 
 const bool benchmarking = false;
+// the decks benchmarking loads, one per line. ../BenchmarkGen/hardDecks.txt is the stress corpus corpusMiner writes
+const char* const benchmarkDeckFile = "../BenchmarkGen/benchmarkDecks.txt";
+// when true, deals are solved one at a time with every thread working on the same deal (see parallelSolver.h)
+const bool intraGameParallel = false;
+// first pass budget per deal, 0 means unlimited. Deals that run out are parked and solved after the first pass (see budget.h)
+const uint64_t dealNodeBudget = 0;
+const int64_t dealTimeBudgetMicros = 0;
+// when > 0 the escalation tier races this many move orders on each parked deal, one thread each and the first to finish
+// wins, instead of splitting one search between the threads (see portfolio.h)
+const int portfolioWidth = 0;
+// when true, random deals of VariantRules (see rules.h) are solved instead of the standard game
+const bool runVariant = false;
+typedef ReducedDeckRules VariantRules;
+// when true, the run asks for a target precision instead of a game count and stops once the
+// Wilson interval on the unsolvable percentage is that narrow at this confidence (see adaptive.h)
+const bool adaptiveStopping = false;
+const double adaptiveConfidence = 0.99;
+// when true, the run asks for a number of deals and solves every transposition of two cards of each deal of
+// benchmarkDeckFile, reusing the deal's own search for the positions both swapped cards are gone from (see deltaSolve.h)
+const bool transpositionScan = false;
+// when true, the run asks for a number of games and estimates how many a player who only sees the top cards wins,
+// deciding each move on hiddenSamples random completions of the unseen cards (see hiddenInfo.h). Deals come from dealSeed
+const bool hiddenInformation = false;
+const int hiddenSamples = 32;
+
+// the search that checks each deal. DFS_ENGINE is solve() (with the budgets above), NOGOOD_ENGINE adds nogood learning (see nogood.h),
+// INTERLEAVED_ENGINE keeps interleaveWidth deals in flight per thread, prefetching their visited sets (see interleave.h, no budgets),
+// BIDIRECTIONAL_ENGINE searches from both the deal and the empty board (see bidirectional.h, no budgets),
+// LAYERED_ENGINE expands one layer of states at a time (see frontier.h, no budgets, and with intraGameParallel the layers are split between the threads)
+// LATTICE_ENGINE sweeps a bit array over every pile depth tuple, forward for reachability then backward for solvability
+// (see latticeDP.h, no budgets, 45 MB of bit arrays per thread)
+// REDUCED_ENGINE is solve() without the redundant orders of independent moves (see partialOrder.h, no budgets). With verifyReduction
+// every deal is also searched with solve() and the report counts the verdicts that differ
+// CANONICAL_ENGINE is solve() with states that only differ in the order of their piles merged in the visited set (see symmetry.h, no budgets).
+// With compareCanonical every deal is also searched with plain solve() and the report compares the states and time of the two
+// DEAD_STATE_ENGINE is solve() cutting positions that provably can't be cleared (see deadState.h, no budgets). With verifyDeadStates
+// every cut position is also searched with solve() and the report shows any rule that was wrong
+enum Engine { DFS_ENGINE, NOGOOD_ENGINE, INTERLEAVED_ENGINE, BIDIRECTIONAL_ENGINE, LAYERED_ENGINE, LATTICE_ENGINE, REDUCED_ENGINE,
+    CANONICAL_ENGINE, DEAD_STATE_ENGINE };
+const Engine engine = DFS_ENGINE;
+const int interleaveWidth = 4;
+const bool verifyDeadStates = false;
+const bool verifyReduction = false;
+const bool compareCanonical = false;
+// when true, DFS_ENGINE without budgets or arenas runs on the widest search kernels this CPU supports, picked at startup
+// (see cpuDispatch.h, GAY_GORDONS_KERNELS=scalar|avx2|avx512 caps the choice)
+const bool dispatchKernels = true;
+// cheap playouts each deal gets before the engine's full search, 0 for none (see playout.h). Ignored by INTERLEAVED_ENGINE
+const int playoutCount = 0;
+// when true, each worker is pinned to a core and keeps its visited sets in a block on its own NUMA node (see numa.h),
+// backed by huge pages if localHugePages is set. DTLB and remote node counters are reported if perf counters are available
+const bool numaLocal = false;
+const bool localHugePages = true;
+const size_t localArenaBytes = size_t(64) << 20;
+// when set, the outcome of every deal is written to this file, one bit per deal (see outcomeFile.h). Random deals are then
+// dealt from dealSeed (0 picks a seed, which is reported and stored in the file) so the bits can be tied back to the deals,
+// and firstDealIndex makes the run a shard starting at that deal of the seed's sequence
+const string outcomeFilePath = "";
+const uint64_t dealSeed = 0;
+const uint64_t firstDealIndex = 0;
+// when true, each worker splits its hardware counters (or just its time, if counters aren't available) between the
+// phases of checking a deal and the report shows them per deal and per search node (see phaseProfile.h).
+// Deals are then checked with plain solve(), the engine and budgets above are ignored
+const bool phaseProfiling = false;
+// where the thread timeline is written when built with GAY_GORDONS_TRACE defined (see trace.h)
+const char* const traceFilePath = "trace.json";
 
 int numSimulations = 100000;
 
-bool solve (GameState& state, unordered_set<GameState, GameStateHasher>& visited) {
-    bool allEmpty = true;
-    for (int i = 0; i < NUM_PILES; ++i) {
-        if (getTopPileCard(&state, i) != 15) {
-            allEmpty = false;
-            break;
-        }
+// per-thread scratch for the engines, and counters that are added to the run totals when the thread finishes
+struct WorkerContext {
+    NogoodTable nogoods;
+    uint64_t nogoodsLearned = 0;
+    uint64_t nogoodHits = 0;
+    Arena* arena = nullptr;
+    PhaseProfiler* profiler = nullptr;
+    PlayoutCounters playouts = PlayoutCounters();
+    uint64_t random = 0x9E3779B97F4A7C15ull;
+    uint64_t statesVisited = 0;
+    unique_ptr<DepthLattice> lattice;
+    LatticeStats latticeStats = LatticeStats();
+    CanonicalStats canonical = CanonicalStats();
+    ReductionCounters reduction = ReductionCounters();
+    DeadStateCounters deadStates = DeadStateCounters();
+};
+
+// counters for the end of run report, summed over the threads under the mutex
+struct RunCounters {
+    uint64_t nogoodsLearned = 0;
+    uint64_t nogoodHits = 0;
+    uint64_t interleavedNodes = 0;
+    uint64_t statesVisited = 0;
+    uint64_t splitLayers = 0;
+    int pinnedThreads = 0;
+    int nodeBoundArenas = 0;
+    int hugePageArenas = 0;
+    uint64_t arenaHeapFallbacks = 0;
+    bool perfAvailable = false;
+    uint64_t dtlbMisses = 0;
+    uint64_t remoteAccesses = 0;
+    PhaseTotals phases = PhaseTotals();
+    PlayoutCounters playouts = PlayoutCounters();
+    LatticeStats lattice = LatticeStats();
+    CanonicalStats canonical = CanonicalStats();
+    ReductionCounters reduction = ReductionCounters();
+    DeadStateCounters deadStates = DeadStateCounters();
+};
+
+// the full search of one deal with the configured engine
+BudgetResult checkDealWithEngine(GameState* state, WorkerContext& context) {
+    if (engine == BIDIRECTIONAL_ENGINE) {
+        uint64_t states = 0;
+        bool solvable = isSolvableBidirectional(state, &states);
+        context.statesVisited += states;
+        return solvable ? SOLVABLE : UNSOLVABLE;
     }
-    if (allEmpty && getTopReserveCard(&state) == 15) return true;
-
-    if (visited.find(state) != visited.end()) return false;
-    visited.insert(state);
-    // try to find a valid pair from piles
-    for (int i = 0; i < NUM_PILES; ++i) {
-        int topCard1 = getTopPileCard(&state, i);
-        if (topCard1 != 15) {
-            for (int j = i + 1; j < NUM_PILES; ++j) {
-                int topCard2 = getTopPileCard(&state, j);
-                if (topCard2 != 15 && isPair(topCard1, topCard2)) {
-                    int card1 = removeTopPileCard(&state, i);
-                    int card2 = removeTopPileCard(&state, j);
-                    if (solve(state, visited)) return true;
-                    addPileCard(&state, i, card1);
-                    addPileCard(&state, j, card2);
-                }
-            }
-        }
+    if (engine == LAYERED_ENGINE) {
+        LayeredStats stats;
+        bool solvable = isSolvableLayered(state, 1, &stats);
+        context.statesVisited += stats.states;
+        return solvable ? SOLVABLE : UNSOLVABLE;
     }
-    // try to find a valid pair between reserve and piles
-    int topReserve = getTopReserveCard(&state);
-    if (topReserve != 15) {
-        for (int i = 0; i < NUM_PILES; ++i) {
-            int topCard = getTopPileCard(&state, i);
-            if (topCard != 15 && isPair(topReserve, topCard)) {
-                int card = removeTopPileCard(&state, i);
-                int reserve = removeTopReserveCard(&state);
-                if (solve(state, visited)) return true;
-                addPileCard(&state, i, card);
-                addReserveCard(&state, reserve);
-            }
-        }
+    if (engine == LATTICE_ENGINE) {
+        if (!context.lattice) context.lattice.reset(new DepthLattice());
+        return isSolvableLattice(state, *context.lattice, &context.latticeStats) ? SOLVABLE : UNSOLVABLE;
     }
-    return false;
-}
-
-// inline helper function to see if any given pile has three jacks
-inline bool hasThreeJacks(GameState* state) {
-    for (int i = 0; i < NUM_PILES; ++i) {;
-        int jackCount = 0;
-        uint32_t pile = state->piles[i];
-        for (int j = 0; j < PILE_SIZE; ++j) {
-            //int card = pile >> (4 * i) & 0x0F;
-            int card = pile & 0x0F;
-            pile >>= 4;
-            if (card == 10) {
-                jackCount++;
-                if (jackCount >= 3) {
-                    return true;
-                }
-            }
-        }
+    if (engine == DEAD_STATE_ENGINE) {
+        return isSolvableWithDeadStates(state, context.deadStates, verifyDeadStates) ? SOLVABLE : UNSOLVABLE;
+    }
+    if (engine == CANONICAL_ENGINE) {
+        return isSolvableCanonical(state, context.canonical, compareCanonical) ? SOLVABLE : UNSOLVABLE;
+    }
+    if (engine == REDUCED_ENGINE) {
+        return isSolvableReduced(state, context.reduction, verifyReduction) ? SOLVABLE : UNSOLVABLE;
+    }
+    if (engine == NOGOOD_ENGINE) {
+        bool solvable = isSolvableWithNogoods(state, context.nogoods);
+        context.nogoodsLearned += context.nogoods.learned;
+        context.nogoodHits += context.nogoods.hits;
+        return solvable ? SOLVABLE : UNSOLVABLE;
     }
-    return false;
+    if (context.arena && !dealNodeBudget && !dealTimeBudgetMicros) {
+        return isSolvableInArena(state, *context.arena) ? SOLVABLE : UNSOLVABLE;
+    }
+    if (dispatchKernels && !dealNodeBudget && !dealTimeBudgetMicros) {
+        return searchKernels().isSolvable(state) ? SOLVABLE : UNSOLVABLE;
+    }
+    return isSolvableWithinBudget(state, dealNodeBudget, dealTimeBudgetMicros);
 }
 
-// function which check to see if a state is solvable
-bool isSolvable(GameState* state) {
-    unordered_set<GameState, GameStateHasher> visited;
-    if (hasThreeJacks(state)) { 
-        //std::cout << "Impossible to solve (3 Jacks in a stack)." << std::endl; 
-        return false; 
+// first pass check of one deal: the playouts if there are any, then the configured engine
+BudgetResult checkDeal(GameState* state, WorkerContext& context) {
+    if (context.profiler) {
+        return isSolvableProfiled(state, *context.profiler) ? SOLVABLE : UNSOLVABLE;
     }
-    return solve(*state, visited);
+    if (playoutCount && !hasThreeJacks(state)) {
+        // the engine only runs if every playout fails, its time is counted as the search phase
+        if (solvedByPlayouts(*state, playoutCount, context.random, context.playouts)) return SOLVABLE;
+        auto start = chrono::steady_clock::now();
+        context.playouts.searches++;
+        BudgetResult result = checkDealWithEngine(state, context);
+        context.playouts.searchSolvable += result == SOLVABLE;
+        context.playouts.searchNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        return result;
+    }
+    return checkDealWithEngine(state, context);
 }
 
 /* function which runs on a thread, running simulations.
-Input is a the number of simulations it should run, the offset if benchmarking
+Input is the index of the thread (used to pin it), the number of simulations it should run, the offset if benchmarking
 of where to access the array of game states, and a reference to the total unsolvable count (passed as mutex),
-a reference to a mutex, and a reference to the game state array
+a reference to a mutex, a reference to the game state array, the overflow queue (guarded by the same mutex)
+that deals over the first pass budget are parked in along with their deal numbers, the run counters (also guarded by the mutex),
+and the outcome file and deal seed if outcomes are being written (null otherwise)
 */
-void simulateGames(int numSimsThisThread, int offset, int& unsolvableCount, mutex& mtx, GameState* gameArray) {
-    if (benchmarking) {
+void simulateGames(int threadIndex, int numSimsThisThread, int offset, int& unsolvableCount, mutex& mtx, GameState* gameArray, vector<GameState>& overflow,
+    vector<uint64_t>& overflowDeals, RunCounters& counters, OutcomeWriter* outcomes, uint64_t seed) {
+    WorkerContext context;
+    OutcomeRecorder recorder(outcomes);
+    Arena arena;
+    PerfCounters perf;
+    bool pinned = false;
+    if (numaLocal) {
+        // pin first, so the arena is placed on the node the thread will stay on
+        pinned = pinThreadToCore(threadIndex);
+        initArena(arena, localArenaBytes, localHugePages);
+        context.arena = &arena;
+        openPerfCounters(perf, (1u << PERF_DTLB_MISSES) | (1u << PERF_REMOTE_NODE_ACCESSES));
+    }
+    TRACE_THREAD_NAME("worker " + to_string(threadIndex));
+    unique_ptr<PhaseProfiler> profiler;
+    if (phaseProfiling) {
+        profiler.reset(new PhaseProfiler());
+        context.profiler = profiler.get();
+    }
+    uint64_t interleavedNodes = 0;
+    if (engine == INTERLEAVED_ENGINE) {
+        InterleavedSolver solver(interleaveWidth);
+        solver.run(numSimsThisThread, [&](uint64_t i, GameState& state) {
+            TRACE_BATCH_DEAL();
+            if (benchmarking) {
+                state = gameArray[offset + i];
+            } else if (outcomes) {
+                initializeGameStateFromSeed(&state, seed, firstDealIndex + offset + i);
+            } else {
+                initializeGameState(&state);
+            }
+        }, [&](uint64_t i, bool solvable) {
+            recorder.record((benchmarking ? 0 : firstDealIndex) + offset + i, !solvable);
+            if (!solvable) {
+                TRACED_LOCK(lock, mtx);
+                unsolvableCount++;
+            }
+        });
+        interleavedNodes = solver.nodesExpanded();
+    } else if (benchmarking) {
         for (int i = 0; i < numSimsThisThread; ++i) {
-            if (!isSolvable(&gameArray[offset + i])) {
-                lock_guard<mutex> lock(mtx);
+            TRACE_BATCH_DEAL();
+            if (profiler) profiler->startDeal();
+            BudgetResult result;
+            {
+                TRACE_LONG_SPAN("long deal", offset + i);
+                result = checkDeal(&gameArray[offset + i], context);
+            }
+            recorder.record(offset + i, result == UNSOLVABLE);
+            if (result == UNSOLVABLE) {
+                TRACED_LOCK(lock, mtx);
                 unsolvableCount++;
+            } else if (result == OVER_BUDGET) {
+                TRACED_LOCK(lock, mtx);
+                overflow.push_back(gameArray[offset + i]);
+                overflowDeals.push_back(offset + i);
             }
         }
     } else {
         for (int i = 0; i < numSimsThisThread; ++i) {
+            TRACE_BATCH_DEAL();
+            if (profiler) profiler->startDeal();
             GameState active;
-            initializeGameState(&active);
-            if (!isSolvable(&active)) {
-                lock_guard<mutex> lock(mtx);
+            uint64_t deal = firstDealIndex + offset + i;
+            if (outcomes) {
+                initializeGameStateFromSeed(&active, seed, deal);
+            } else {
+                initializeGameState(&active);
+            }
+            BudgetResult result;
+            {
+                TRACE_LONG_SPAN("long deal", deal);
+                result = checkDeal(&active, context);
+            }
+            recorder.record(deal, result == UNSOLVABLE);
+            if (result == UNSOLVABLE) {
+                TRACED_LOCK(lock, mtx);
                 unsolvableCount++;
                 if (unsolvableCount % 200000 == 0) {
                     cout << "Offset counter: " << unsolvableCount / 200000 << " million" << endl;
                 }
+            } else if (result == OVER_BUDGET) {
+                TRACED_LOCK(lock, mtx);
+                overflow.push_back(active);
+                overflowDeals.push_back(deal);
             }
         }
     }
+    TRACE_BATCH_END();
+    uint64_t perfValues[PERF_EVENT_COUNT] = {};
+    if (numaLocal) {
+        readPerfCounters(perf, perfValues);
+        closePerfCounters(perf);
+        freeLocal(arena.block);
+    }
+    TRACED_LOCK(lock, mtx);
+    counters.nogoodsLearned += context.nogoodsLearned;
+    counters.nogoodHits += context.nogoodHits;
+    counters.interleavedNodes += interleavedNodes;
+    counters.statesVisited += context.statesVisited;
+    counters.lattice.reachable += context.latticeStats.reachable;
+    counters.lattice.good += context.latticeStats.good;
+    counters.lattice.forwardNanos += context.latticeStats.forwardNanos;
+    counters.lattice.backwardNanos += context.latticeStats.backwardNanos;
+    addCanonicalStats(counters.canonical, context.canonical);
+    addReductionCounters(counters.reduction, context.reduction);
+    addDeadStateCounters(counters.deadStates, context.deadStates);
+    addPlayoutCounters(counters.playouts, context.playouts);
+    if (profiler) {
+        addPhaseTotals(counters.phases, profiler->finish());
+    }
+    if (numaLocal) {
+        counters.pinnedThreads += pinned;
+        counters.nodeBoundArenas += arena.block.nodeBound;
+        counters.hugePageArenas += arena.block.hugePages || arena.block.transparentHuge;
+        counters.arenaHeapFallbacks += arena.heapFallbacks;
+        counters.perfAvailable |= perf.available;
+        counters.dtlbMisses += perfValues[PERF_DTLB_MISSES];
+        counters.remoteAccesses += perfValues[PERF_REMOTE_NODE_ACCESSES];
+    }
+}
+
+/* function which runs on a thread, running simulations of a rules variant (see rules.h) with random deals.
+The count is shared with the other threads through the mutex the same way as simulateGames.
+*/
+template <class Rules>
+void simulateVariantGames(int numSimsThisThread, int& unsolvableCount, mutex& mtx) {
+    for (int i = 0; i < numSimsThisThread; ++i) {
+        BasicGameState<Rules> active;
+        initializeGameState(&active);
+        if (!isSolvable(&active)) {
+            lock_guard<mutex> lock(mtx);
+            unsolvableCount++;
+        }
+    }
+}
+
+/* function which runs the simulations one deal at a time, splitting each deal's search across numThreads threads.
+Used when a single deal's latency matters more than throughput across deals.
+*/
+void simulateGamesIntraGame(int numSims, int numThreads, int& unsolvableCount, GameState* gameArray, RunCounters& counters) {
+    // 4M slots (32 MB), reused for every deal
+    ConcurrentVisitedSet visited(22);
+    for (int i = 0; i < numSims; ++i) {
+        GameState active;
+        if (benchmarking) {
+            active = gameArray[i];
+        } else {
+            initializeGameState(&active);
+        }
+        bool solvable;
+        if (engine == LAYERED_ENGINE) {
+            LayeredStats stats;
+            solvable = isSolvableLayered(&active, numThreads, &stats);
+            counters.statesVisited += stats.states;
+            counters.splitLayers += stats.splitLayers;
+        } else {
+            solvable = isSolvableParallel(&active, numThreads, visited);
+        }
+        if (!solvable) {
+            unsolvableCount++;
+        }
+    }
 }
 
 int main() {
+    TRACE_THREAD_NAME("main");
+    if (adaptiveStopping) {
+        double targetPoints;
+        std::cout << "Enter target precision (+- percentage points): ";
+        std::cin >> targetPoints;
+        runAdaptive(thread::hardware_concurrency(), targetPoints, adaptiveConfidence, 0);
+        return 0;
+    }
+
+    if (transpositionScan) {
+        int numDeals;
+        std::cout << "Enter number of deals to scan: ";
+        std::cin >> numDeals;
+        runTranspositionScan(benchmarkDeckFile, numDeals);
+        return 0;
+    }
+
+    if (hiddenInformation) {
+        uint64_t numGames;
+        std::cout << "Enter number of games: ";
+        std::cin >> numGames;
+        uint64_t seed = dealSeed;
+        if (!seed) {
+            random_device rd;
+            seed = (uint64_t(rd()) << 32) | rd();
+        }
+        cout << "Deal seed: " << seed << endl;
+        auto start = chrono::steady_clock::now();
+        HiddenStats stats = estimateHiddenWinRate(numGames, hiddenSamples, max(1, int(thread::hardware_concurrency())), seed);
+        printHiddenStats(stats, hiddenSamples, adaptiveConfidence);
+        cout << "Total time: " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " milliseconds." << endl;
+        return 0;
+    }
+
     // create an array of game states
     GameState* gameArray = new GameState[numSimulations];
     
     if (benchmarking) {
+        TRACE_SPAN("load decks");
         std::cout << "Loading decks..." << std::endl;
         auto start = chrono::steady_clock::now();
-        loadDecksToStates(gameArray, numSimulations);
+        loadDecksToStates(gameArray, numSimulations, benchmarkDeckFile);
         auto end = chrono::steady_clock::now();
         auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
         std::cout << "Decks loaded in " << duration.count() << " milliseconds." << std::endl;
@@ -166,22 +456,134 @@ int main() {
     int remainderSimulations = numSimulations % numThreads;
 
     int unsolvableCount = 0;
+    vector<GameState> overflow;
+    vector<uint64_t> overflowDeals;
+    RunCounters counters;
+    OutcomeWriter outcomes;
+    bool outcomesOpen = false;
     cout << numThreads << " threads will be used." << endl;
+    if (dispatchKernels && engine == DFS_ENGINE) cout << "Search kernels: " << searchKernels().name << endl;
     cout << "Number of simulations per thread: " << simulationsPerThread << endl;
     cout << "Number of remainder simulations: " << remainderSimulations << endl;
-    int offsetCounter = 0;
-    for (int i = 0; i < numThreads; ++i) {
-        int simulationsForThisThread = simulationsPerThread + (i < remainderSimulations ? 1 : 0);
-        threads.emplace_back(simulateGames, simulationsForThisThread, offsetCounter, ref(unsolvableCount), ref(mtx), ref(gameArray));
-        offsetCounter += simulationsForThisThread;
-    }
-    
-    for (auto& t : threads) {
-        t.join();
+    if (intraGameParallel) {
+        simulateGamesIntraGame(numSimulations, numThreads, unsolvableCount, gameArray, counters);
+    } else if (runVariant) {
+        for (int i = 0; i < numThreads; ++i) {
+            int simulationsForThisThread = simulationsPerThread + (i < remainderSimulations ? 1 : 0);
+            threads.emplace_back(simulateVariantGames<VariantRules>, simulationsForThisThread, ref(unsolvableCount), ref(mtx));
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    } else {
+        uint64_t seed = dealSeed;
+        if (!outcomeFilePath.empty()) {
+            if (!benchmarking && !seed) {
+                random_device rd;
+                seed = (uint64_t(rd()) << 32) | rd();
+            }
+            if (outcomes.open(outcomeFilePath, benchmarking ? 0 : firstDealIndex, numSimulations, benchmarking ? 0 : seed,
+                    benchmarking ? OUTCOME_CORPUS : OUTCOME_SEEDED, numThreads)) {
+                outcomesOpen = true;
+                if (!benchmarking) cout << "Deal seed: " << seed << ", first deal: " << firstDealIndex << endl;
+            } else {
+                cout << "Could not create outcome file " << outcomeFilePath << endl;
+            }
+        }
+        int offsetCounter = 0;
+        for (int i = 0; i < numThreads; ++i) {
+            int simulationsForThisThread = simulationsPerThread + (i < remainderSimulations ? 1 : 0);
+            threads.emplace_back(simulateGames, i, simulationsForThisThread, offsetCounter, ref(unsolvableCount), ref(mtx), ref(gameArray), ref(overflow),
+                ref(overflowDeals), ref(counters), outcomesOpen ? &outcomes : nullptr, seed);
+            offsetCounter += simulationsForThisThread;
+        }
+
+        {
+            TRACE_SPAN("first pass");
+            for (auto& t : threads) {
+                t.join();
+            }
+        }
+
+        if (!overflow.empty()) {
+            TRACE_SPAN("escalation tier");
+            auto escalationStart = chrono::steady_clock::now();
+            vector<size_t> lateUnsolvable;
+            if (portfolioWidth) {
+                PortfolioSolver portfolio(portfolioWidth);
+                unsolvableCount += solveOverflowPortfolio(overflow, portfolio, &lateUnsolvable);
+                printPortfolioStats(portfolio);
+            } else {
+                unsolvableCount += solveOverflow(overflow, numThreads, &lateUnsolvable);
+            }
+            for (size_t i = 0; outcomesOpen && i < lateUnsolvable.size(); ++i) {
+                outcomes.markUnsolvable(overflowDeals[lateUnsolvable[i]]);
+            }
+            auto escalationDuration = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - escalationStart);
+            cout << "Escalation tier time: " << escalationDuration.count() << " milliseconds." << endl;
+        }
     }
     double unsolvablePercentage = (double)unsolvableCount / numSimulations * 100;
     cout << "Unsolvable percentage: " << unsolvablePercentage << "%" << endl;
     cout << "Unsolvable count: " << unsolvableCount << endl;
+    if (dealNodeBudget || dealTimeBudgetMicros) {
+        cout << "Escalated deals: " << overflow.size() << endl;
+    }
+    if (numaLocal) {
+        cout << "Pinned threads: " << counters.pinnedThreads << ", NUMA bound arenas: " << counters.nodeBoundArenas
+            << ", huge page arenas: " << counters.hugePageArenas << ", arena overflows to heap: " << counters.arenaHeapFallbacks << endl;
+        if (counters.perfAvailable) {
+            cout << "dTLB misses: " << counters.dtlbMisses << endl;
+            cout << "Remote node accesses: " << counters.remoteAccesses << endl;
+        } else {
+            cout << "Performance counters not available." << endl;
+        }
+    }
+    if (phaseProfiling) {
+        printPhaseTotals(counters.phases);
+    }
+    if (playoutCount && engine != INTERLEAVED_ENGINE) {
+        printPlayoutCounters(counters.playouts, playoutCount);
+    }
+    if (engine == INTERLEAVED_ENGINE) {
+        cout << "Interleave width: " << interleaveWidth << ", states expanded: " << counters.interleavedNodes << endl;
+    }
+    if (engine == BIDIRECTIONAL_ENGINE || engine == LAYERED_ENGINE) {
+        cout << "States visited: " << counters.statesVisited << endl;
+    }
+    if (engine == CANONICAL_ENGINE) {
+        printCanonicalStats(counters.canonical, compareCanonical);
+    }
+    if (engine == LAYERED_ENGINE && intraGameParallel) {
+        cout << "Layers split between threads: " << counters.splitLayers << endl;
+    }
+    if (engine == LATTICE_ENGINE) {
+        cout << "Lattice states reachable: " << counters.lattice.reachable << ", of them can reach the goal: " << counters.lattice.good << endl;
+        cout << "Forward sweep: " << counters.lattice.forwardNanos / 1000000 << " milliseconds, backward sweep: "
+            << counters.lattice.backwardNanos / 1000000 << " milliseconds" << endl;
+    }
+    if (engine == DEAD_STATE_ENGINE) {
+        printDeadStateCounters(counters.deadStates);
+    }
+    if (engine == REDUCED_ENGINE) {
+        printReductionCounters(counters.reduction);
+    }
+    if (engine == NOGOOD_ENGINE) {
+        cout << "Nogoods learned: " << counters.nogoodsLearned << endl;
+        cout << "States cut by nogoods: " << counters.nogoodHits << endl;
+    }
+    if (outcomesOpen) {
+        TRACE_SPAN("write outcomes");
+        if (outcomes.finish()) {
+            cout << "Outcomes written to " << outcomeFilePath << endl;
+        } else {
+            cout << "Writing outcome file " << outcomeFilePath << " failed." << endl;
+        }
+    }
+    if (!TRACE_DUMP(traceFilePath)) {
+        cout << "Could not write trace file " << traceFilePath << endl;
+    }
     auto totalEnd = chrono::steady_clock::now();
     auto totalDuration = chrono::duration_cast<chrono::milliseconds>(totalEnd - totalStart);
     std::cout << "Total time: " << totalDuration.count() << " milliseconds." << std::endl;
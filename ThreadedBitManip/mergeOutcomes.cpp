@@ -0,0 +1,28 @@
+/* Joins outcome file shards (see outcomeFile.h) from runs over consecutive deal ranges into one file,
+  checking that they fit together and that each shard's bits match its header.
+  Build: cl /O2 /EHsc mergeOutcomes.cpp   or   g++ -O2 mergeOutcomes.cpp -pthread -o mergeOutcomes
+  Usage: mergeOutcomes <output> <shard> [shard...]
+*/
+
+#include <iostream>
+
+#include "outcomeFile.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <output> <shard> [shard...]" << endl;
+        return 1;
+    }
+    vector<string> inputs(argv + 2, argv + argc);
+    string error;
+    if (!mergeOutcomeFiles(inputs, argv[1], error)) {
+        cerr << "Merge failed: " << error << endl;
+        return 1;
+    }
+    OutcomeHeader header;
+    vector<uint8_t> bits;
+    readOutcomeFile(argv[1], header, bits);
+    cout << "Deals " << header.firstDeal << " to " << header.firstDeal + header.dealCount - 1 << ", unsolvable: " << header.unsolvableCount
+        << " (" << (double)header.unsolvableCount / header.dealCount * 100 << "%), checksum: " << hex << header.checksum << endl;
+    return 0;
+}
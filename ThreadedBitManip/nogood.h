@@ -0,0 +1,205 @@
+#pragma once
+
+/* Nogood learning. The visited set only catches exact repeats of a state, but deadness usually comes from a
+  small part of the position: a couple of piles whose remaining cards can't all be paired off, whatever the rest of the
+  board does. When a subtree fails, this looks for such a part and remembers it, like a conflict clause in a SAT solver.
+
+  A nogood is a pair of "piles" (the reserve counts as pile 10) at given depths (cards removed). It is dead if those
+  remaining cards can't be cleared even in a relaxed game where every card of the deal outside the two piles is
+  available at any time: the two tops may pair with each other, or a top may pair with any unused outside card of a
+  partner rank. The outside cards of any real state are a subset of those, so every state with the two piles at those
+  depths is dead as well, and pruning it is exact. A single pile is the case p == q.
+
+  The relaxed check only depends on the deal and the two depths, so each (p, q, depth p, depth q) is worked out at most
+  once per deal, the first time a failed state shows it, and cached as a bit in the table.
+*/
+
+#include "solver.h"
+
+// a failed state is only analysed if its subtree had at least this many states, below that learning costs more than it saves
+const size_t NOGOOD_LEARN_THRESHOLD = 16;
+
+// the reserve is handled as an eleventh pile of two cards
+const int NOGOOD_PILES = 11;
+const int NOGOOD_RESERVE = 10;
+
+// per-deal table of learned nogoods, plus the depths of the state being searched
+struct NogoodTable {
+    int cards[NOGOOD_PILES][5]; // the deal, top card first
+    int sizes[NOGOOD_PILES];    // 5 for piles, 2 for the reserve
+    int depth[NOGOOD_PILES];    // cards removed so far in the current state
+    uint64_t known[NOGOOD_PILES][NOGOOD_PILES]; // bit a * 6 + b set once (p, q, a, b) has been checked, p <= q
+    uint64_t dead[NOGOOD_PILES][NOGOOD_PILES];  // bit a * 6 + b set if (p, q, a, b) is dead
+    uint64_t learned;
+    uint64_t hits;
+};
+
+// sets up the table for a deal: records the cards and forgets every nogood
+void initNogoodTable(NogoodTable& table, const GameState& deal) {
+    for (int i = 0; i < NUM_PILES; ++i) {
+        for (int j = 0; j < PILE_SIZE; ++j) {
+            table.cards[i][j] = (deal.piles[i] >> (j * 4)) & 0x0F;
+        }
+        table.sizes[i] = PILE_SIZE;
+    }
+    table.cards[NOGOOD_RESERVE][0] = deal.reserve & 0x0F;
+    table.cards[NOGOOD_RESERVE][1] = (deal.reserve >> 4) & 0x0F;
+    table.sizes[NOGOOD_RESERVE] = RESERVE_SIZE;
+    for (int i = 0; i < NOGOOD_PILES; ++i) {
+        table.depth[i] = 0;
+        for (int j = 0; j < NOGOOD_PILES; ++j) {
+            table.known[i][j] = 0;
+            table.dead[i][j] = 0;
+        }
+    }
+    table.learned = 0;
+    table.hits = 0;
+}
+
+/* the relaxed game on piles p and q from depths a and b, with pool[rank] outside cards of each rank available.
+Returns true if both piles can be cleared */
+bool relaxedClearable(const NogoodTable& table, int p, int q, int a, int b, int* pool) {
+    int topP = a < table.sizes[p] ? table.cards[p][a] : 15;
+    int topQ = (p != q && b < table.sizes[q]) ? table.cards[q][b] : 15;
+    if (topP == 15 && topQ == 15) return true;
+    if (topP != 15 && topQ != 15 && isPair(topP, topQ) && relaxedClearable(table, p, q, a + 1, b + 1, pool)) return true;
+    for (int rank = 0; rank < 13; ++rank) {
+        if (pool[rank] == 0) continue;
+        if (topP != 15 && isPair(topP, rank)) {
+            pool[rank]--;
+            bool clearable = relaxedClearable(table, p, q, a + 1, b, pool);
+            pool[rank]++;
+            if (clearable) return true;
+        }
+        if (topQ != 15 && isPair(topQ, rank)) {
+            pool[rank]--;
+            bool clearable = relaxedClearable(table, p, q, a, b + 1, pool);
+            pool[rank]++;
+            if (clearable) return true;
+        }
+    }
+    return false;
+}
+
+// checks (p, q) at the current depths if that hasn't been done yet, returns true if it is dead
+bool checkNogood(NogoodTable& table, int p, int q) {
+    const int a = table.depth[p];
+    const int b = p == q ? 0 : table.depth[q];
+    const uint64_t bit = uint64_t(1) << (a * 6 + b);
+    if (!(table.known[p][q] & bit)) {
+        table.known[p][q] |= bit;
+        // every card of the deal outside the two piles
+        int pool[13] = { 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4 };
+        for (int j = 0; j < table.sizes[p]; ++j) pool[table.cards[p][j]]--;
+        if (p != q) {
+            for (int j = 0; j < table.sizes[q]; ++j) pool[table.cards[q][j]]--;
+        }
+        if (!relaxedClearable(table, p, q, a, b, pool)) {
+            table.dead[p][q] |= bit;
+            table.learned++;
+        }
+    }
+    return (table.dead[p][q] & bit) != 0;
+}
+
+/* called when the subtree of the current state failed: learn the pile pairs involving pile p that explain the failure.
+Pairs that don't involve the piles of the last move looked the same in the parent, they get checked if the parent fails */
+void learnNogoods(NogoodTable& table, int p) {
+    if (table.depth[p] == table.sizes[p]) return;
+    for (int q = 0; q < NOGOOD_PILES; ++q) {
+        if (q != p && table.depth[q] == table.sizes[q]) continue;
+        checkNogood(table, p < q ? p : q, p < q ? q : p);
+    }
+}
+
+// helper to test the learned nogoods that involve pile p (only those can have changed since the parent was checked)
+inline bool matchesNogood(const NogoodTable& table, int p) {
+    for (int q = 0; q < NOGOOD_PILES; ++q) {
+        int low = p < q ? p : q;
+        int high = p < q ? q : p;
+        int a = table.depth[low];
+        int b = low == high ? 0 : table.depth[high];
+        if (table.dead[low][high] & (uint64_t(1) << (a * 6 + b))) return true;
+    }
+    return false;
+}
+
+/* the same search as solve(), plus: a new state is dropped before the visited lookup if the piles moved to reach it match a learned nogood,
+and a state whose subtree failed is analysed for new nogoods. moved1 and moved2 are the piles the last move took
+cards from (-1 at the root) */
+bool solveWithNogoods(GameState& state, unordered_set<GameState, GameStateHasher>& visited, NogoodTable& table, int moved1, int moved2) {
+    bool allEmpty = true;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (getTopPileCard(&state, i) != 15) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == 15) return true;
+
+    if (moved1 >= 0 && (matchesNogood(table, moved1) || matchesNogood(table, moved2))) {
+        table.hits++;
+        return false;
+    }
+    if (visited.find(state) != visited.end()) return false;
+    visited.insert(state);
+    const size_t visitedBefore = visited.size();
+    // try to find a valid pair from piles
+    for (int i = 0; i < NUM_PILES; ++i) {
+        int topCard1 = getTopPileCard(&state, i);
+        if (topCard1 != 15) {
+            for (int j = i + 1; j < NUM_PILES; ++j) {
+                int topCard2 = getTopPileCard(&state, j);
+                if (topCard2 != 15 && isPair(topCard1, topCard2)) {
+                    int card1 = removeTopPileCard(&state, i);
+                    int card2 = removeTopPileCard(&state, j);
+                    table.depth[i]++;
+                    table.depth[j]++;
+                    if (solveWithNogoods(state, visited, table, i, j)) return true;
+                    table.depth[i]--;
+                    table.depth[j]--;
+                    addPileCard(&state, i, card1);
+                    addPileCard(&state, j, card2);
+                }
+            }
+        }
+    }
+    // try to find a valid pair between reserve and piles
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve != 15) {
+        for (int i = 0; i < NUM_PILES; ++i) {
+            int topCard = getTopPileCard(&state, i);
+            if (topCard != 15 && isPair(topReserve, topCard)) {
+                int card = removeTopPileCard(&state, i);
+                int reserve = removeTopReserveCard(&state);
+                table.depth[i]++;
+                table.depth[NOGOOD_RESERVE]++;
+                if (solveWithNogoods(state, visited, table, i, NOGOOD_RESERVE)) return true;
+                table.depth[i]--;
+                table.depth[NOGOOD_RESERVE]--;
+                addPileCard(&state, i, card);
+                addReserveCard(&state, reserve);
+            }
+        }
+    }
+    if (visited.size() - visitedBefore >= NOGOOD_LEARN_THRESHOLD) {
+        if (moved1 < 0) {
+            for (int p = 0; p < NOGOOD_PILES; ++p) learnNogoods(table, p);
+        } else {
+            learnNogoods(table, moved1);
+            learnNogoods(table, moved2);
+        }
+    }
+    return false;
+}
+
+// function which checks to see if a state is solvable with nogood learning. table is reset for the deal,
+// its learned and hits counters are for this deal only
+bool isSolvableWithNogoods(GameState* state, NogoodTable& table) {
+    initNogoodTable(table, *state);
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    unordered_set<GameState, GameStateHasher> visited;
+    return solveWithNogoods(*state, visited, table, -1, -1);
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+/* Thread pinning and NUMA / huge page aware memory for the workers.
+  By default the workers are plain std::threads that the OS can move between cores and sockets, and every visited set
+  comes from the global heap in 4 KB pages, so on a dual socket box a lot of the hash probes go to the other socket's
+  memory and miss the TLB. With these:
+    - pinThreadToCore() fixes a worker to one logical core,
+    - allocateLocal() gets a block on the calling thread's NUMA node, backed by explicit huge pages if the system has
+      them reserved, otherwise transparent huge pages, otherwise normal pages,
+    - Arena / ArenaAllocator hand that block out to a worker's visited set. The arena is reset after every deal,
+      which also takes malloc and free out of the search.
+  Everything falls back quietly: if a step isn't supported it is skipped and the rest still works.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "solver.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// helper to pin the calling thread to a logical core, returns false if that isn't possible here
+bool pinThreadToCore(int core) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    if (core >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+// helper to find the NUMA node of the core the calling thread is on, 0 if unknown
+int currentNumaNode() {
+#ifdef __linux__
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return static_cast<int>(node);
+#elif defined(_WIN32)
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    if (GetNumaProcessorNodeEx(&processor, &node)) return node;
+#endif
+    return 0;
+}
+
+// what allocateLocal() managed to get, for the end of run report
+struct LocalAllocation {
+    void* memory;
+    size_t bytes;
+    bool hugePages;     // explicit (or, on Windows, large) pages
+    bool transparentHuge; // transparent huge pages were requested
+    bool nodeBound;     // memory is bound to the thread's NUMA node
+};
+
+const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+/* allocates bytes on the calling thread's NUMA node, trying explicit huge pages first if hugePages is set.
+  memory is null only if even a plain allocation failed */
+LocalAllocation allocateLocal(size_t bytes, bool hugePages) {
+    LocalAllocation allocation = { nullptr, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE, false, false, false };
+    const int node = currentNumaNode();
+#ifdef __linux__
+    void* memory = MAP_FAILED;
+    if (hugePages) {
+        memory = mmap(nullptr, allocation.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        allocation.hugePages = memory != MAP_FAILED;
+    }
+    if (memory == MAP_FAILED) {
+        memory = mmap(nullptr, allocation.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return allocation;
+#ifdef MADV_HUGEPAGE
+        if (hugePages) {
+            allocation.transparentHuge = madvise(memory, allocation.bytes, MADV_HUGEPAGE) == 0;
+        }
+#endif
+    }
+#ifdef SYS_mbind
+    // MPOL_PREFERRED (1): use this node while it has memory, spill elsewhere rather than fail
+    unsigned long nodeMask[16] = {};
+    if (node < 16 * 64) {
+        nodeMask[node / 64] = 1ul << (node % 64);
+        allocation.nodeBound = syscall(SYS_mbind, memory, allocation.bytes, 1, nodeMask, 16 * 64, 0) == 0;
+    }
+#endif
+    allocation.memory = memory;
+#elif defined(_WIN32)
+    void* memory = nullptr;
+    if (hugePages) {
+        // needs SeLockMemoryPrivilege, without it this fails and normal pages are used
+        SIZE_T largePage = GetLargePageMinimum();
+        if (largePage) {
+            SIZE_T bytesLarge = (allocation.bytes + largePage - 1) / largePage * largePage;
+            memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytesLarge, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+            if (memory) {
+                allocation.bytes = bytesLarge;
+                allocation.hugePages = true;
+            }
+        }
+    }
+    if (!memory) {
+        memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, allocation.bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+    }
+    allocation.nodeBound = memory != nullptr;
+    allocation.memory = memory;
+#else
+    (void)node;
+    allocation.memory = ::operator new(allocation.bytes, std::nothrow);
+#endif
+    return allocation;
+}
+
+void freeLocal(LocalAllocation& allocation) {
+    if (!allocation.memory) return;
+#ifdef __linux__
+    munmap(allocation.memory, allocation.bytes);
+#elif defined(_WIN32)
+    VirtualFree(allocation.memory, 0, MEM_RELEASE);
+#else
+    ::operator delete(allocation.memory);
+#endif
+    allocation.memory = nullptr;
+}
+
+/* A bump allocator over one worker's local block. Allocations that don't fit any more go to the global heap,
+  so a huge deal still works, it just doesn't get local memory for the overflow. reset() frees everything at once. */
+struct Arena {
+    LocalAllocation block;
+    size_t used;
+    uint64_t heapFallbacks;
+};
+
+void initArena(Arena& arena, size_t bytes, bool hugePages) {
+    arena.block = allocateLocal(bytes, hugePages);
+    arena.used = 0;
+    arena.heapFallbacks = 0;
+}
+
+inline void* arenaAllocate(Arena& arena, size_t bytes) {
+    size_t start = (arena.used + 15) & ~size_t(15);
+    if (arena.block.memory && start + bytes <= arena.block.bytes) {
+        arena.used = start + bytes;
+        return static_cast<char*>(arena.block.memory) + start;
+    }
+    arena.heapFallbacks++;
+    return ::operator new(bytes);
+}
+
+inline void arenaFree(Arena& arena, void* pointer) {
+    char* base = static_cast<char*>(arena.block.memory);
+    if (base && pointer >= base && pointer < base + arena.block.bytes) return;
+    ::operator delete(pointer);
+}
+
+// forget every allocation in the block, only call it once nothing from the arena is in use
+inline void resetArena(Arena& arena) {
+    arena.used = 0;
+}
+
+// STL allocator over an Arena, so the standard unordered_set can keep its nodes and buckets in the worker's local block
+template <class T>
+struct ArenaAllocator {
+    typedef T value_type;
+    Arena* arena;
+
+    explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arenaAllocate(*arena, count * sizeof(T)));
+    }
+    void deallocate(T* pointer, size_t) {
+        arenaFree(*arena, pointer);
+    }
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+typedef unordered_set<GameState, GameStateHasher, equal_to<GameState>, ArenaAllocator<GameState>> ArenaVisitedSet;
+
+// function which checks to see if a state is solvable, keeping the visited set in the worker's arena
+bool isSolvableInArena(GameState* state, Arena& arena) {
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    bool solvable;
+    {
+        ArenaVisitedSet visited(64, GameStateHasher(), equal_to<GameState>(), ArenaAllocator<GameState>(&arena));
+        solvable = solve(*state, visited);
+    }
+    resetArena(arena);
+    return solvable;
+}
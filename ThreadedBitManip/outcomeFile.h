@@ -0,0 +1,340 @@
+#pragma once
+
+/* Per-deal outcome file: a fixed header followed by one bit per deal, 1 if the deal is unsolvable, in deal order
+  (corpus line order, or seed index order for seeded random deals, see initializeGameStateFromSeed). Bit i of byte i / 8
+  is deal firstDeal + i, lowest bit first. A billion deals is 125 MB.
+
+  Solver threads never touch the file. Each one fills an OutcomeRecorder for the part of a block its deals fall in and
+  hands it over when its deals cross into the next block. A writer thread ORs the parts together and writes each block
+  at its place in the file as soon as every deal in it has been recorded, so blocks go out in large writes in whatever
+  order they complete. Deals whose outcome is only known later (the escalation tier) are recorded as solvable and
+  patched in by markUnsolvable() before finish().
+
+  The checksum is the sum of mix64(deal index) over the unsolvable deals, so it doesn't depend on the order deals were
+  solved in, and the checksum of a set of shards covering a range is the sum of theirs. mergeOutcomeFiles() joins
+  shards covering consecutive ranges into one file.
+*/
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gameState.h"
+#include "print.h"
+
+const char OUTCOME_MAGIC[8] = { 'G', 'G', 'O', 'U', 'T', 'C', '1', 0 };
+const uint32_t OUTCOME_VERSION = 1;
+// deals per block, 128 KB of bits
+const uint64_t OUTCOME_BLOCK_DEALS = uint64_t(1) << 20;
+const uint64_t OUTCOME_BLOCK_WORDS = OUTCOME_BLOCK_DEALS / 64;
+
+// where the deals of a run came from
+enum OutcomeSource : uint32_t { OUTCOME_SEEDED = 0, OUTCOME_CORPUS = 1 };
+
+// the header at the start of the file, 64 bytes, little endian
+struct OutcomeHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t firstDeal;       // index of the first deal in the file
+    uint64_t dealCount;
+    uint64_t unsolvableCount;
+    uint64_t seed;            // deal seed for OUTCOME_SEEDED, 0 for a corpus
+    uint32_t source;
+    uint32_t numThreads;
+    uint64_t checksum;
+};
+static_assert(sizeof(OutcomeHeader) == 64, "the outcome header is 64 bytes on disk");
+
+// helper for the checksum: what one unsolvable deal adds to it
+inline uint64_t outcomeChecksumTerm(uint64_t dealIndex) {
+    return mix64(dealIndex);
+}
+
+// helper to get the number of deals in a block, the last block of a file is usually short
+inline uint64_t outcomeBlockDeals(uint64_t dealCount, uint64_t block) {
+    uint64_t start = block * OUTCOME_BLOCK_DEALS;
+    return dealCount - start < OUTCOME_BLOCK_DEALS ? dealCount - start : OUTCOME_BLOCK_DEALS;
+}
+
+// part of a block recorded by one thread: the bits it set and how many of the block's deals it recorded
+struct OutcomeSegment {
+    uint64_t block;
+    uint64_t count;
+    vector<uint64_t> words;
+};
+
+class OutcomeWriter {
+public:
+    OutcomeWriter() : file(nullptr), stopping(false), failed(false), unsolvable(0), checksum(0) {}
+
+    ~OutcomeWriter() {
+        if (file) finish();
+    }
+
+    // creates the file and starts the writer thread, false if the file can't be created
+    bool open(const string& path, uint64_t firstDeal, uint64_t dealCount, uint64_t seed, OutcomeSource source, int numThreads) {
+        file = fopen(path.c_str(), "wb+");
+        if (!file) return false;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, OUTCOME_MAGIC, sizeof(OUTCOME_MAGIC));
+        header.version = OUTCOME_VERSION;
+        header.headerBytes = sizeof(OutcomeHeader);
+        header.firstDeal = firstDeal;
+        header.dealCount = dealCount;
+        header.seed = seed;
+        header.source = source;
+        header.numThreads = static_cast<uint32_t>(numThreads);
+        stopping = false;
+        failed = false;
+        unsolvable = 0;
+        checksum = 0;
+        writer = thread(&OutcomeWriter::writerLoop, this);
+        return true;
+    }
+
+    uint64_t firstDeal() const { return header.firstDeal; }
+    uint64_t dealCount() const { return header.dealCount; }
+
+    // hands a recorded segment to the writer thread, the segment's words are taken
+    void submit(OutcomeSegment& segment) {
+        {
+            lock_guard<mutex> lock(mtx);
+            queue.push_back(OutcomeSegment());
+            queue.back().block = segment.block;
+            queue.back().count = segment.count;
+            queue.back().words.swap(segment.words);
+        }
+        wake.notify_one();
+    }
+
+    // sets a deal that was recorded as solvable to unsolvable, for outcomes decided after the first pass
+    void markUnsolvable(uint64_t deal) {
+        lock_guard<mutex> lock(mtx);
+        late.push_back(deal);
+    }
+
+    // waits for every block to be written, applies the late outcomes and writes the header. false if anything failed
+    bool finish() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        for (uint64_t deal : late) {
+            uint64_t bit = deal - header.firstDeal;
+            uint8_t byte = 0;
+            long offset = static_cast<long>(sizeof(OutcomeHeader) + bit / 8);
+            if (fseek(file, offset, SEEK_SET) || fread(&byte, 1, 1, file) != 1) {
+                failed = true;
+                continue;
+            }
+            if (byte & (1u << (bit % 8))) continue;
+            byte |= 1u << (bit % 8);
+            fseek(file, offset, SEEK_SET);
+            failed |= fwrite(&byte, 1, 1, file) != 1;
+            unsolvable++;
+            checksum += outcomeChecksumTerm(deal);
+        }
+        late.clear();
+        failed |= !pending.empty();
+        header.unsolvableCount = unsolvable;
+        header.checksum = checksum;
+        failed |= fseek(file, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, file) != 1;
+        failed |= fclose(file) != 0;
+        file = nullptr;
+        return !failed;
+    }
+
+private:
+    struct PendingBlock {
+        vector<uint64_t> words;
+        uint64_t recorded;
+    };
+
+    void writerLoop() {
+        vector<OutcomeSegment> taken;
+        for (;;) {
+            {
+                unique_lock<mutex> lock(mtx);
+                wake.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                taken.swap(queue);
+            }
+            for (OutcomeSegment& segment : taken) {
+                PendingBlock& block = pending[segment.block];
+                if (block.words.empty()) {
+                    block.words.assign(OUTCOME_BLOCK_WORDS, 0);
+                    block.recorded = 0;
+                }
+                for (size_t w = 0; w < segment.words.size(); ++w) {
+                    block.words[w] |= segment.words[w];
+                }
+                block.recorded += segment.count;
+                if (block.recorded == outcomeBlockDeals(header.dealCount, segment.block)) {
+                    writeBlock(segment.block, block.words);
+                    pending.erase(segment.block);
+                }
+            }
+            taken.clear();
+        }
+    }
+
+    void writeBlock(uint64_t block, const vector<uint64_t>& words) {
+        uint64_t deals = outcomeBlockDeals(header.dealCount, block);
+        uint64_t base = header.firstDeal + block * OUTCOME_BLOCK_DEALS;
+        for (uint64_t w = 0; w * 64 < deals; ++w) {
+            if (!words[w]) continue;
+            for (int b = 0; b < 64; ++b) {
+                if (words[w] >> b & 1) {
+                    unsolvable++;
+                    checksum += outcomeChecksumTerm(base + w * 64 + b);
+                }
+            }
+        }
+        // words are little endian, so their bytes are already in file order
+        long offset = static_cast<long>(sizeof(OutcomeHeader) + block * (OUTCOME_BLOCK_DEALS / 8));
+        failed |= fseek(file, offset, SEEK_SET) || fwrite(words.data(), 1, (deals + 7) / 8, file) != (deals + 7) / 8;
+    }
+
+    FILE* file;
+    OutcomeHeader header;
+    thread writer;
+    mutex mtx;
+    condition_variable wake;
+    vector<OutcomeSegment> queue;
+    vector<uint64_t> late;
+    map<uint64_t, PendingBlock> pending; // blocks some but not all deals of have arrived for, only used by the writer thread
+    bool stopping;
+    bool failed;
+    uint64_t unsolvable;
+    uint64_t checksum;
+};
+
+/* A solver thread's side of the outcome file. The bits for the current block are kept here and submitted when a deal
+  lands in another block, so deals should be recorded in roughly increasing order (each thread solves a consecutive range).
+  Going back to an earlier block still works, it just submits that block's bits in more pieces. */
+struct OutcomeRecorder {
+    OutcomeWriter* writer;
+    OutcomeSegment segment;
+
+    explicit OutcomeRecorder(OutcomeWriter* writer) : writer(writer) {
+        segment.count = 0;
+    }
+
+    ~OutcomeRecorder() {
+        flush();
+    }
+
+    void record(uint64_t deal, bool unsolvable) {
+        if (!writer) return;
+        uint64_t bit = deal - writer->firstDeal();
+        uint64_t block = bit / OUTCOME_BLOCK_DEALS;
+        if (segment.count && block != segment.block) {
+            flush();
+        }
+        if (!segment.count) {
+            segment.block = block;
+            segment.words.assign(OUTCOME_BLOCK_WORDS, 0);
+        }
+        uint64_t inBlock = bit % OUTCOME_BLOCK_DEALS;
+        segment.words[inBlock / 64] |= uint64_t(unsolvable) << (inBlock % 64);
+        segment.count++;
+    }
+
+    void flush() {
+        if (!writer || !segment.count) return;
+        writer->submit(segment);
+        segment.count = 0;
+    }
+};
+
+// reads an outcome file's header and bitmap, false if it isn't a complete outcome file
+bool readOutcomeFile(const string& path, OutcomeHeader& header, vector<uint8_t>& bits) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, OUTCOME_MAGIC, sizeof(OUTCOME_MAGIC)) == 0
+        && header.version == OUTCOME_VERSION && header.headerBytes == sizeof(OutcomeHeader);
+    if (ok) {
+        bits.assign((header.dealCount + 7) / 8, 0);
+        ok = fread(bits.data(), 1, bits.size(), file) == bits.size();
+    }
+    fclose(file);
+    return ok;
+}
+
+/* joins shards into one outcome file. The shards must be from the same source (and seed) and cover consecutive
+  ranges, in any order. The totals and checksum are recounted from the bits and checked against each shard's header.
+  Returns false, with the reason in error, if they don't fit together */
+bool mergeOutcomeFiles(const vector<string>& inputs, const string& output, string& error) {
+    map<uint64_t, pair<OutcomeHeader, vector<uint8_t>>> shards;
+    for (const string& input : inputs) {
+        OutcomeHeader header;
+        vector<uint8_t> bits;
+        if (!readOutcomeFile(input, header, bits)) {
+            error = input + " is not a complete outcome file";
+            return false;
+        }
+        if (!shards.empty() && (header.source != shards.begin()->second.first.source || header.seed != shards.begin()->second.first.seed)) {
+            error = input + " is from a different run source or seed";
+            return false;
+        }
+        if (!shards.emplace(header.firstDeal, make_pair(header, move(bits))).second) {
+            error = input + " starts at the same deal as another shard";
+            return false;
+        }
+    }
+    if (shards.empty()) {
+        error = "no input files";
+        return false;
+    }
+
+    OutcomeHeader merged = shards.begin()->second.first;
+    merged.dealCount = 0;
+    merged.unsolvableCount = 0;
+    merged.checksum = 0;
+    vector<uint8_t> bits;
+    for (auto& entry : shards) {
+        const OutcomeHeader& header = entry.second.first;
+        const vector<uint8_t>& shardBits = entry.second.second;
+        if (header.firstDeal != merged.firstDeal + merged.dealCount) {
+            error = "shards don't cover consecutive deals, gap or overlap at deal " + to_string(header.firstDeal);
+            return false;
+        }
+        uint64_t unsolvable = 0, checksum = 0;
+        for (uint64_t i = 0; i < header.dealCount; ++i) {
+            if (!(shardBits[i / 8] >> (i % 8) & 1)) continue;
+            uint64_t bit = merged.dealCount + i;
+            if (bits.size() <= bit / 8) bits.resize(bit / 8 + 1, 0);
+            bits[bit / 8] |= uint8_t(1u << (bit % 8));
+            unsolvable++;
+            checksum += outcomeChecksumTerm(header.firstDeal + i);
+        }
+        if (unsolvable != header.unsolvableCount || checksum != header.checksum) {
+            error = "shard starting at deal " + to_string(header.firstDeal) + " doesn't match its header";
+            return false;
+        }
+        merged.dealCount += header.dealCount;
+        merged.unsolvableCount += unsolvable;
+        merged.checksum += checksum;
+        merged.numThreads = header.numThreads > merged.numThreads ? header.numThreads : merged.numThreads;
+    }
+    bits.resize((merged.dealCount + 7) / 8, 0);
+
+    FILE* file = fopen(output.c_str(), "wb");
+    if (!file) {
+        error = "can't create " + output;
+        return false;
+    }
+    bool ok = fwrite(&merged, sizeof(merged), 1, file) == 1 && fwrite(bits.data(), 1, bits.size(), file) == bits.size();
+    ok &= fclose(file) == 0;
+    if (!ok) error = "writing " + output + " failed";
+    return ok;
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+/* Intra-game parallel search. Everything else in this program runs one deal per thread, so a single
+  hard deal (usually an unsolvable one that has to be explored completely) still runs on one core.
+  This splits the search of ONE deal across threads instead:
+    - every worker owns a deque of subtree roots. It pops its own work from the back and, when it runs dry,
+      steals from the front of someone else's deque (work stealing).
+    - while any worker is idle, a worker that is still shallow in the tree (depth < splitDepth) hands its
+      untried children out as new tasks instead of recursing into them, so the split happens at shallow depth
+      and only when somebody actually needs work.
+    - all workers share one lock-free visited set keyed on stateKey(), so no subtree is searched twice.
+    - the first worker to reach the empty board sets a shared flag and everybody else stops.
+    - the workers come from the shared pool (see workerPool.h), so nothing is started per deal, and a worker with
+      nothing to steal sleeps until a task is pushed or the search ends.
+  A state that one thread marked as visited and is still exploring is skipped by the others. That is still exact:
+  the owner explores it fully unless the search is cancelled by a solution, which is the answer anyway.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "solver.h"
+#include "workerPool.h"
+
+/* Lock-free visited set for the keys made by stateKey(). Each slot is a 64 bit word holding
+  (generation << 32 | key + 1), so the table can be reused for the next deal by bumping the generation
+  instead of clearing it. Linear probing, insert only. If a key can't be placed within maxProbe slots
+  it is reported as new: that only costs re-exploring a state, never a wrong answer.
+*/
+struct ConcurrentVisitedSet {
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    uint32_t mask;
+    uint64_t generation;
+    static const int maxProbe = 64;
+
+    // capacityLog2 is the log2 of the number of slots, e.g. 20 is 1M slots (8 MB)
+    explicit ConcurrentVisitedSet(int capacityLog2) : slots(new std::atomic<uint64_t>[size_t(1) << capacityLog2]),
+        mask((uint32_t(1) << capacityLog2) - 1), generation(1) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // forget every key. Not thread safe, call it between deals
+    void reset() {
+        generation++;
+    }
+
+    // returns true if the key was not in the set (and is now), false if it was already there
+    bool insert(uint32_t key) {
+        const uint64_t entry = (generation << 32) | (uint64_t(key) + 1);
+        uint32_t index = (key * 0x9E3779B1u) & mask;
+        for (int probe = 0; probe < maxProbe; ++probe) {
+            std::atomic<uint64_t>& slot = slots[(index + probe) & mask];
+            uint64_t current = slot.load(std::memory_order_relaxed);
+            if (current == entry) return false;
+            // anything from an older generation counts as an empty slot
+            while ((current >> 32) != generation) {
+                if (slot.compare_exchange_weak(current, entry, std::memory_order_relaxed)) return true;
+                if (current == entry) return false;
+            }
+        }
+        return true;
+    }
+};
+
+// a subtree root waiting in a worker's deque, with how many moves it is from the deal
+struct SearchTask {
+    GameState state;
+    int depth;
+};
+
+// a worker's deque of tasks. Padded so two workers' locks don't share a cache line
+// (padding rather than alignas, over-aligned new needs C++17)
+struct WorkQueue {
+    std::mutex mtx;
+    std::deque<SearchTask> tasks;
+    char padding[64];
+};
+
+// state shared by all the workers searching one deal
+struct ParallelSearch {
+    ConcurrentVisitedSet& visited;
+    std::unique_ptr<WorkQueue[]> queues;
+    int numWorkers;
+    int splitDepth;
+    std::atomic<bool> found;
+    std::atomic<int> pending; // tasks pushed but not finished yet
+    std::atomic<int> queued;  // tasks sitting in a deque
+    std::atomic<int> idle;    // workers currently looking for work
+    std::atomic<int> sleepers;
+    std::atomic<uint64_t> nodes;
+    std::mutex sleepMtx;
+    std::condition_variable workReady;
+
+    ParallelSearch(ConcurrentVisitedSet& visited, int numWorkers, int splitDepth) : visited(visited),
+        queues(new WorkQueue[numWorkers]), numWorkers(numWorkers), splitDepth(splitDepth),
+        found(false), pending(0), queued(0), idle(numWorkers), sleepers(0), nodes(0) {}
+
+    void push(int worker, const GameState& state, int depth) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            lock_guard<mutex> lock(queues[worker].mtx);
+            queues[worker].tasks.push_back(SearchTask{ state, depth });
+        }
+        // queued before sleepers is read, a sleeper counts itself before it reads queued, so one of us sees the other
+        queued.fetch_add(1);
+        if (sleepers.load() > 0) {
+            { lock_guard<mutex> lock(sleepMtx); }
+            workReady.notify_one();
+        }
+    }
+
+    // sleeps until there may be a task to take or the search is over
+    void waitForWork() {
+        unique_lock<mutex> lock(sleepMtx);
+        sleepers.fetch_add(1);
+        workReady.wait(lock, [&] { return queued.load() > 0 || found.load() || pending.load() == 0; });
+        sleepers.fetch_sub(1);
+    }
+
+    // wakes every sleeper, once the search is over
+    void wakeAll() {
+        { lock_guard<mutex> lock(sleepMtx); }
+        workReady.notify_all();
+    }
+
+    // pop from the back of our own deque, otherwise steal from the front of the others
+    bool take(int worker, SearchTask& task) {
+        {
+            lock_guard<mutex> lock(queues[worker].mtx);
+            if (!queues[worker].tasks.empty()) {
+                task = queues[worker].tasks.back();
+                queues[worker].tasks.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (int k = 1; k < numWorkers; ++k) {
+            WorkQueue& victim = queues[(worker + k) % numWorkers];
+            lock_guard<mutex> lock(victim.mtx);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/* The same search as solve(), but against the shared visited set, checking the cancel flag at every node
+  and handing children out as tasks when other workers are idle.
+*/
+bool parallelSolve(GameState& state, int depth, ParallelSearch& search, int worker, uint64_t& nodes) {
+    if (search.found.load(std::memory_order_relaxed)) return false;
+    bool allEmpty = true;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (getTopPileCard(&state, i) != 15) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == 15) {
+        search.found.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (!search.visited.insert(stateKey(state))) return false;
+    nodes++;
+    const bool split = depth < search.splitDepth;
+    // try to find a valid pair from piles
+    for (int i = 0; i < NUM_PILES; ++i) {
+        int topCard1 = getTopPileCard(&state, i);
+        if (topCard1 != 15) {
+            for (int j = i + 1; j < NUM_PILES; ++j) {
+                int topCard2 = getTopPileCard(&state, j);
+                if (topCard2 != 15 && isPair(topCard1, topCard2)) {
+                    int card1 = removeTopPileCard(&state, i);
+                    int card2 = removeTopPileCard(&state, j);
+                    if (split && search.idle.load(std::memory_order_relaxed) > 0) {
+                        search.push(worker, state, depth + 1);
+                    } else if (parallelSolve(state, depth + 1, search, worker, nodes)) {
+                        return true;
+                    }
+                    addPileCard(&state, i, card1);
+                    addPileCard(&state, j, card2);
+                }
+            }
+        }
+    }
+    // try to find a valid pair between reserve and piles
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve != 15) {
+        for (int i = 0; i < NUM_PILES; ++i) {
+            int topCard = getTopPileCard(&state, i);
+            if (topCard != 15 && isPair(topReserve, topCard)) {
+                int card = removeTopPileCard(&state, i);
+                int reserve = removeTopReserveCard(&state);
+                if (split && search.idle.load(std::memory_order_relaxed) > 0) {
+                    search.push(worker, state, depth + 1);
+                } else if (parallelSolve(state, depth + 1, search, worker, nodes)) {
+                    return true;
+                }
+                addPileCard(&state, i, card);
+                addReserveCard(&state, reserve);
+            }
+        }
+    }
+    return false;
+}
+
+// each worker's share of the search: take tasks until a solution is found or every task is done
+void parallelSearchWorker(ParallelSearch& search, int worker) {
+    uint64_t nodes = 0;
+    SearchTask task;
+    while (!search.found.load(std::memory_order_relaxed) && search.pending.load(std::memory_order_acquire) > 0) {
+        if (!search.take(worker, task)) {
+            search.waitForWork();
+            continue;
+        }
+        search.idle.fetch_sub(1, std::memory_order_relaxed);
+        bool solved = parallelSolve(task.state, task.depth, search, worker, nodes);
+        search.idle.fetch_add(1, std::memory_order_relaxed);
+        if (search.pending.fetch_sub(1, std::memory_order_acq_rel) == 1 || solved) search.wakeAll();
+    }
+    search.nodes.fetch_add(nodes, std::memory_order_relaxed);
+}
+
+/* function which checks if a state is solvable using numThreads threads on this one deal, the calling thread and
+  numThreads - 1 workers of the shared pool (the first call sizes it).
+  visited is reset before use, so the same table can be passed in for every deal.
+  nodesExpanded, if given, receives the number of states expanded by all the workers together.
+*/
+bool isSolvableParallel(GameState* state, int numThreads, ConcurrentVisitedSet& visited, int splitDepth = 8, uint64_t* nodesExpanded = nullptr) {
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    visited.reset();
+    WorkerPool& pool = sharedWorkerPool(numThreads);
+    const int numWorkers = 1 + min(numThreads - 1, pool.size());
+    ParallelSearch search(visited, numWorkers, splitDepth);
+    search.push(0, *state, 0);
+    pool.run([&search](int helper) {
+        parallelSearchWorker(search, helper);
+        return false;
+    }, numWorkers - 1);
+    if (nodesExpanded) *nodesExpanded = search.nodes.load();
+    return search.found.load();
+}
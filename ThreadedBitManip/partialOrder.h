@@ -0,0 +1,186 @@
+#pragma once
+
+/* Partial order reduction. Two moves that touch different piles (and don't both use the reserve) are independent:
+  either can be played first, both stay playable, and both orders end in the same state. solve() plays both orders
+  and only finds out at the visited set that the second one leads nowhere new. This search numbers the moves in
+  solve()'s order and never plays a move right after an independent move with a higher number, so of every two
+  adjacent independent moves only the ascending order is generated.
+  That alone doesn't mix with a visited set, a state first reached with some moves blocked would never get those
+  moves played when it is reached again with them allowed. So the visited set keeps, per state, the moves still
+  blocked at every arrival so far (the intersection of the blocked sets), and an arrival that unblocks moves plays
+  just those. Every move outside a state's stored set has then been played from it.
+  Why nothing is lost: among all the orderings of a winning line (swapping adjacent independent moves), take the
+  lexicographically smallest. It has no adjacent independent pair in descending order, or swapping them would give a
+  smaller one, so each of its moves is allowed after the one before. By induction along the line, every state on it is
+  reached by the line's own move, which doesn't block the next one, so the next move is played from it too.
+  With verification on, every deal is also searched with solve() and the report counts the verdicts that differ.
+*/
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "solver.h"
+
+// slots are the piles and the reserve (slot NUM_PILES). Moves are numbered in solve()'s order: pile pairs (i, j) with
+// i < j first, then pile i with the reserve
+const int NUM_MOVES = NUM_PILES * (NUM_PILES - 1) / 2 + NUM_PILES;
+
+struct MoveTable {
+    int8_t a[NUM_MOVES];
+    int8_t b[NUM_MOVES];                                 // NUM_PILES for the reserve
+    uint64_t blockedAfter[NUM_MOVES];                    // bit m: move m is independent of this one and numbered lower
+};
+
+// the move table, built on first use
+const MoveTable& moveTable() {
+    static const MoveTable table = [] {
+        MoveTable t;
+        int m = 0;
+        for (int i = 0; i < NUM_PILES; ++i) {
+            for (int j = i + 1; j < NUM_PILES; ++j, ++m) {
+                t.a[m] = int8_t(i);
+                t.b[m] = int8_t(j);
+            }
+        }
+        for (int i = 0; i < NUM_PILES; ++i, ++m) {
+            t.a[m] = int8_t(i);
+            t.b[m] = int8_t(NUM_PILES);
+        }
+        for (int p = 0; p < NUM_MOVES; ++p) {
+            t.blockedAfter[p] = 0;
+            for (int q = 0; q < p; ++q) {
+                if (t.a[q] != t.a[p] && t.a[q] != t.b[p] && t.b[q] != t.a[p] && t.b[q] != t.b[p]) {
+                    t.blockedAfter[p] |= uint64_t(1) << q;
+                }
+            }
+        }
+        return t;
+    }();
+    return table;
+}
+
+// counters for the report, per thread and then summed
+struct ReductionCounters {
+    uint64_t deals;
+    uint64_t transitions;   // moves played, each one a visited set probe unless it clears the board
+    uint64_t pruned;        // moves blocked at a state's first arrival, solve() plays all of them
+    uint64_t reexpanded;    // later arrivals at a state that unblocked moves and played them
+    uint64_t replayed;      // moves those arrivals played, so solve() would play pruned - replayed more moves
+    uint64_t verified;      // deals also searched with solve()
+    uint64_t mismatches;    // of them, deals where solve() came to the other verdict
+};
+
+// the visited set of the reduced search: state -> moves blocked at every arrival so far
+typedef unordered_map<GameState, uint64_t, GameStateHasher> ReducedVisited;
+
+// the same search as solve() with the reduction, lastMove is the move that led here (-1 at the deal)
+bool solveReduced(GameState& state, int lastMove, ReducedVisited& visited, ReductionCounters& counters) {
+    bool allEmpty = true;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (getTopPileCard(&state, i) != 15) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == 15) return true;
+
+    const uint64_t blocked = lastMove < 0 ? 0 : moveTable().blockedAfter[lastMove];
+    uint64_t skip = blocked;
+    uint64_t firstArrival = ~uint64_t(0);
+    auto found = visited.find(state);
+    if (found == visited.end()) {
+        visited.emplace(state, blocked);
+    } else {
+        // only the moves an earlier arrival blocked and this one doesn't are left to play
+        uint64_t unblocked = found->second & ~blocked;
+        if (!unblocked) return false;
+        found->second &= blocked;
+        skip = ~unblocked;
+        firstArrival = 0;
+        counters.reexpanded++;
+    }
+
+    // the same loops as solve(), m counts the moves along in the same order
+    for (int i = 0, m = 0; i < NUM_PILES; ++i) {
+        int topCard1 = getTopPileCard(&state, i);
+        if (topCard1 == 15) {
+            m += NUM_PILES - 1 - i;
+            continue;
+        }
+        for (int j = i + 1; j < NUM_PILES; ++j, ++m) {
+            int topCard2 = getTopPileCard(&state, j);
+            if (topCard2 == 15 || !isPair(topCard1, topCard2)) continue;
+            if ((skip >> m) & 1) {
+                counters.pruned += (blocked & firstArrival) >> m & 1;
+                continue;
+            }
+            counters.transitions++;
+            counters.replayed += !firstArrival;
+            int card1 = removeTopPileCard(&state, i);
+            int card2 = removeTopPileCard(&state, j);
+            if (solveReduced(state, m, visited, counters)) return true;
+            addPileCard(&state, i, card1);
+            addPileCard(&state, j, card2);
+        }
+    }
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve != 15) {
+        for (int i = 0, m = NUM_MOVES - NUM_PILES; i < NUM_PILES; ++i, ++m) {
+            int topCard = getTopPileCard(&state, i);
+            if (topCard == 15 || !isPair(topReserve, topCard)) continue;
+            if ((skip >> m) & 1) {
+                counters.pruned += (blocked & firstArrival) >> m & 1;
+                continue;
+            }
+            counters.transitions++;
+            counters.replayed += !firstArrival;
+            int card = removeTopPileCard(&state, i);
+            int reserve = removeTopReserveCard(&state);
+            if (solveReduced(state, m, visited, counters)) return true;
+            addPileCard(&state, i, card);
+            addReserveCard(&state, reserve);
+        }
+    }
+    return false;
+}
+
+// function which checks to see if a state is solvable with the reduced search. verify checks the verdict with solve()
+bool isSolvableReduced(GameState* state, ReductionCounters& counters, bool verify = false) {
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    counters.deals++;
+    ReducedVisited visited;
+    GameState active = *state;
+    bool solvable = solveReduced(active, -1, visited, counters);
+    if (verify) {
+        unordered_set<GameState, GameStateHasher> fresh;
+        GameState copy = *state;
+        counters.verified++;
+        counters.mismatches += solve(copy, fresh) != solvable;
+    }
+    return solvable;
+}
+
+void addReductionCounters(ReductionCounters& into, const ReductionCounters& from) {
+    into.deals += from.deals;
+    into.transitions += from.transitions;
+    into.pruned += from.pruned;
+    into.reexpanded += from.reexpanded;
+    into.replayed += from.replayed;
+    into.verified += from.verified;
+    into.mismatches += from.mismatches;
+}
+
+// prints the totals and what the reduction saved per searched deal
+void printReductionCounters(const ReductionCounters& counters) {
+    double deals = counters.deals ? double(counters.deals) : 1.0;
+    cout << "Transitions played: " << counters.transitions << " (" << counters.transitions / deals << " per deal)" << endl;
+    uint64_t avoided = counters.pruned > counters.replayed ? counters.pruned - counters.replayed : 0;
+    cout << "Transitions and visited set probes avoided: " << avoided << " (" << avoided / deals << " per deal)" << endl;
+    cout << "States re-expanded for unblocked moves: " << counters.reexpanded << ", replaying " << counters.replayed << " transitions" << endl;
+    if (counters.verified) {
+        cout << "Verdicts checked with solve(): " << counters.verified << ", mismatches: " << counters.mismatches << endl;
+    }
+}
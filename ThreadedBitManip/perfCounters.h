@@ -0,0 +1,222 @@
+#pragma once
+
+/* Thin wrapper over Linux perf_event_open for counting hardware events on the calling thread.
+  Every counter is opened for the current thread only, so each worker opens its own set and the results are summed.
+  Anywhere the counters can't be opened (not Linux, perf_event_paranoid too high, running in a VM without a PMU)
+  open() leaves them unavailable and read() returns zeros, so callers can always use it and just check `available`.
+  A group (openPerfGroup) is also mapped into memory, and where the kernel lets user space read the counters
+  (cap_user_rdpmc, x86 only) readPerfGroup uses rdpmc instead of a read() syscall, so reading them doesn't go
+  through the kernel and disturb the caches and TLB of the code being measured.
+*/
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+#define PERF_USER_READ 1
+#else
+#define PERF_USER_READ 0
+#endif
+
+// the events callers can ask for
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_REMOTE_NODE_ACCESSES, // loads served by another NUMA node
+    PERF_EVENT_COUNT
+};
+
+const char* const PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "dTLB misses", "branch misses", "remote node accesses"
+};
+
+struct PerfCounters {
+    int fds[PERF_EVENT_COUNT];
+    bool available;
+    // set by openPerfGroup: the events in the order the group reports them, and the fd of the first (the leader)
+    int groupSize;
+    int groupEvents[PERF_EVENT_COUNT];
+    int leader;
+    // also set by openPerfGroup: each group event's mapped page, and whether all of them can be read with rdpmc
+    void* pages[PERF_EVENT_COUNT];
+    bool userRead;
+};
+
+#ifdef __linux__
+// helper to fill in the perf_event_attr type and config for one of our events
+inline void perfEventConfig(PerfEvent event, perf_event_attr& attr) {
+    const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (event) {
+        case PERF_CYCLES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PERF_INSTRUCTIONS: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PERF_L1D_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_L1D | readMiss; break;
+        case PERF_LLC_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case PERF_DTLB_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_DTLB | readMiss; break;
+        case PERF_BRANCH_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        default: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_NODE | readMiss; break;
+    }
+}
+#endif
+
+/* opens counters for the given events on the calling thread and starts them. events is a bit mask of (1 << PerfEvent).
+  Counters are available if at least one of them opened, the ones that didn't just read as zero */
+void openPerfCounters(PerfCounters& counters, uint32_t events) {
+    counters.available = false;
+    counters.groupSize = 0;
+    counters.leader = -1;
+    counters.userRead = false;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters.fds[i] = -1;
+        counters.pages[i] = nullptr;
+#ifdef __linux__
+        if (!(events & (1u << i))) continue;
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        perfEventConfig(PerfEvent(i), attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counters.fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (counters.fds[i] >= 0) {
+            counters.available = true;
+        }
+#else
+        (void)events;
+#endif
+    }
+}
+
+// reads the current value of every counter into values (zero for events that aren't open)
+void readPerfCounters(const PerfCounters& counters, uint64_t values[PERF_EVENT_COUNT]) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        values[i] = 0;
+#ifdef __linux__
+        if (counters.fds[i] >= 0) {
+            uint64_t value = 0;
+            if (read(counters.fds[i], &value, sizeof(value)) == sizeof(value)) {
+                values[i] = value;
+            }
+        }
+#endif
+    }
+}
+
+/* opens the events as one group on the calling thread, so they are always scheduled together (and count exactly the same
+  instructions) and readPerfGroup gets all of them with one read, or with rdpmc where userRead is set.
+  Events that can't be opened are left out of the group */
+void openPerfGroup(PerfCounters& counters, uint32_t events) {
+    counters.available = false;
+    counters.groupSize = 0;
+    counters.leader = -1;
+    counters.userRead = false;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters.fds[i] = -1;
+        counters.pages[i] = nullptr;
+#ifdef __linux__
+        if (!(events & (1u << i))) continue;
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        perfEventConfig(PerfEvent(i), attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        counters.fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, counters.leader, 0));
+        if (counters.fds[i] >= 0) {
+            if (counters.leader < 0) counters.leader = counters.fds[i];
+            void* page = mmap(nullptr, static_cast<size_t>(sysconf(_SC_PAGESIZE)), PROT_READ, MAP_SHARED, counters.fds[i], 0);
+            counters.pages[counters.groupSize] = page == MAP_FAILED ? nullptr : page;
+            counters.groupEvents[counters.groupSize++] = i;
+            counters.available = true;
+        }
+#else
+        (void)events;
+#endif
+    }
+#if PERF_USER_READ
+    counters.userRead = counters.groupSize > 0;
+    for (int k = 0; k < counters.groupSize; ++k) {
+        const perf_event_mmap_page* page = static_cast<const perf_event_mmap_page*>(counters.pages[k]);
+        if (!page || !page->cap_user_rdpmc) counters.userRead = false;
+    }
+#endif
+}
+
+#if PERF_USER_READ
+// helper to read one counter from user space through its mapped page, the sequence linux/perf_event.h documents
+inline uint64_t readPerfPage(const volatile perf_event_mmap_page* page) {
+    uint32_t sequence;
+    uint64_t count;
+    do {
+        sequence = page->lock;
+        __asm__ volatile("" ::: "memory");
+        uint32_t index = page->index;
+        count = page->offset;
+        // index is 0 while the event isn't on a counter, the offset is its value then
+        if (page->cap_user_rdpmc && index) {
+            uint32_t low, high;
+            __asm__ volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+            // the hardware counter is pmc_width bits wide, sign extend it
+            int shift = 64 - page->pmc_width;
+            count += static_cast<uint64_t>(static_cast<int64_t>(((uint64_t(high) << 32) | low) << shift) >> shift);
+        }
+        __asm__ volatile("" ::: "memory");
+    } while (page->lock != sequence);
+    return count;
+}
+#endif
+
+// reads every counter of a group opened by openPerfGroup into values (zero for events that aren't in it)
+inline void readPerfGroup(const PerfCounters& counters, uint64_t values[PERF_EVENT_COUNT]) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        values[i] = 0;
+    }
+#if PERF_USER_READ
+    if (counters.userRead) {
+        for (int k = 0; k < counters.groupSize; ++k) {
+            values[counters.groupEvents[k]] = readPerfPage(static_cast<const volatile perf_event_mmap_page*>(counters.pages[k]));
+        }
+        return;
+    }
+#endif
+#ifdef __linux__
+    if (counters.leader < 0) return;
+    // PERF_FORMAT_GROUP: the number of events, then their values in the order they joined the group
+    uint64_t buffer[PERF_EVENT_COUNT + 1];
+    if (read(counters.leader, buffer, sizeof(buffer)) < ssize_t(sizeof(uint64_t))) return;
+    for (uint64_t i = 0; i < buffer[0] && i < uint64_t(counters.groupSize); ++i) {
+        values[counters.groupEvents[i]] = buffer[i + 1];
+    }
+#endif
+}
+
+void closePerfCounters(PerfCounters& counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+#ifdef __linux__
+        if (counters.pages[i]) {
+            munmap(counters.pages[i], static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        }
+        if (counters.fds[i] >= 0) {
+            close(counters.fds[i]);
+        }
+#endif
+        counters.pages[i] = nullptr;
+        counters.fds[i] = -1;
+    }
+    counters.available = false;
+    counters.userRead = false;
+    counters.groupSize = 0;
+    counters.leader = -1;
+}
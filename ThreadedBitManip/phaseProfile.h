@@ -0,0 +1,163 @@
+#pragma once
+
+/* Per-phase hardware counters for a worker thread. A PhaseProfiler is the probe handed to solve() (see SolverPhase in
+  solver.h): every change of phase reads the thread's counter group and the clock and charges the difference to the
+  phase being left, so cycles, instructions, cache, dTLB and branch misses come out split by deal generation,
+  prefilter, move generation, visited lookup and backtracking.
+  A node changes phase several times, so the counters are read with rdpmc where the kernel allows it (see perfCounters.h)
+  and the clock through the vDSO, neither of which enters the kernel. Where it doesn't, every phase change is a read()
+  syscall: the counters exclude the kernel, but the trip through it still evicts some of the search's L1 and TLB
+  entries, which then show up as misses in the phase that runs next, so the report says which way they were read.
+  The times are only a guide to how the phases compare. Without counters only times are kept.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+
+#include "perfCounters.h"
+#include "solver.h"
+
+const char* const PHASE_NAMES[PHASE_COUNT] = { "deal generation", "prefilter", "move generation", "visited lookup", "backtracking" };
+
+// the events the profiler groups, everything but remote node accesses
+const uint32_t PHASE_PROFILE_EVENTS = (1u << PERF_CYCLES) | (1u << PERF_INSTRUCTIONS) | (1u << PERF_L1D_MISSES) | (1u << PERF_LLC_MISSES)
+    | (1u << PERF_DTLB_MISSES) | (1u << PERF_BRANCH_MISSES);
+
+// what was charged to each phase, summed over threads for the report
+struct PhaseTotals {
+    uint64_t counts[PHASE_COUNT][PERF_EVENT_COUNT];
+    uint64_t nanos[PHASE_COUNT];
+    uint64_t nodes;
+    uint64_t deals;
+    bool countersAvailable;
+    bool syscallReads;    // some thread read its counters with read() rather than rdpmc
+};
+
+void clearPhaseTotals(PhaseTotals& totals) {
+    memset(&totals, 0, sizeof(totals));
+}
+
+void addPhaseTotals(PhaseTotals& into, const PhaseTotals& from) {
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            into.counts[p][e] += from.counts[p][e];
+        }
+        into.nanos[p] += from.nanos[p];
+    }
+    into.nodes += from.nodes;
+    into.deals += from.deals;
+    into.countersAvailable |= from.countersAvailable;
+    into.syscallReads |= from.syscallReads;
+}
+
+class PhaseProfiler : public NoProbe {
+public:
+    // opens the counter group on the calling thread, so a profiler must stay on the thread that made it
+    PhaseProfiler() : current(PHASE_DEAL) {
+        clearPhaseTotals(totals);
+        openPerfGroup(counters, PHASE_PROFILE_EVENTS);
+        totals.countersAvailable = counters.available;
+        totals.syscallReads = counters.available && !counters.userRead;
+        sample(lastCounts, lastTime);
+    }
+
+    ~PhaseProfiler() {
+        closePerfCounters(counters);
+    }
+
+    // starts a new deal, in the deal generation phase
+    void startDeal() {
+        totals.deals++;
+        enter(PHASE_DEAL);
+    }
+
+    void node() {
+        totals.nodes++;
+    }
+
+    void enter(SolverPhase phase) {
+        if (phase == current) return;
+        charge();
+        current = phase;
+    }
+
+    // charges the current phase up to now and returns the totals so far
+    const PhaseTotals& finish() {
+        charge();
+        return totals;
+    }
+
+private:
+    // adds the counts and time since the last sample to the current phase
+    void charge() {
+        uint64_t counts[PERF_EVENT_COUNT];
+        chrono::steady_clock::time_point time;
+        sample(counts, time);
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            totals.counts[current][e] += counts[e] - lastCounts[e];
+            lastCounts[e] = counts[e];
+        }
+        totals.nanos[current] += chrono::duration_cast<chrono::nanoseconds>(time - lastTime).count();
+        lastTime = time;
+    }
+
+    void sample(uint64_t counts[PERF_EVENT_COUNT], chrono::steady_clock::time_point& time) {
+        if (counters.available) {
+            readPerfGroup(counters, counts);
+        } else {
+            for (int e = 0; e < PERF_EVENT_COUNT; ++e) counts[e] = 0;
+        }
+        time = chrono::steady_clock::now();
+    }
+
+    PerfCounters counters;
+    PhaseTotals totals;
+    SolverPhase current;
+    uint64_t lastCounts[PERF_EVENT_COUNT];
+    chrono::steady_clock::time_point lastTime;
+};
+
+// function which checks to see if a state is solvable, telling the profiler about each phase
+bool isSolvableProfiled(GameState* state, PhaseProfiler& profiler) {
+    profiler.enter(PHASE_PREFILTER);
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    unordered_set<GameState, GameStateHasher> visited;
+    return solve(*state, visited, profiler);
+}
+
+// prints the phases' share of the time and their counts per deal and per search node
+void printPhaseTotals(const PhaseTotals& totals) {
+    uint64_t totalNanos = 0;
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        totalNanos += totals.nanos[p];
+    }
+    cout << "Phase profile over " << totals.deals << " deals and " << totals.nodes << " search nodes"
+        << (totals.countersAvailable ? "" : " (performance counters not available, timing only)") << ":" << endl;
+    if (totals.syscallReads) {
+        cout << "  (counters read with a read() syscall at every phase change, rdpmc isn't allowed here: miss counts include"
+            << " the cache and TLB entries those syscalls evict)" << endl;
+    }
+    double deals = totals.deals ? (double)totals.deals : 1.0;
+    double nodes = totals.nodes ? (double)totals.nodes : 1.0;
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        cout << "  " << left << setw(16) << PHASE_NAMES[p] << right << fixed << setprecision(1)
+            << setw(6) << (totalNanos ? 100.0 * totals.nanos[p] / totalNanos : 0.0) << "% of time, "
+            << setprecision(2) << totals.nanos[p] / deals << " ns/deal, " << totals.nanos[p] / nodes << " ns/node" << endl;
+        if (!totals.countersAvailable) continue;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (!(PHASE_PROFILE_EVENTS & (1u << e))) continue;
+            cout << "      " << left << setw(14) << PERF_EVENT_NAMES[e] << right << setw(14) << totals.counts[p][e] / deals
+                << " /deal" << setw(12) << totals.counts[p][e] / nodes << " /node" << endl;
+        }
+        if (totals.counts[p][PERF_CYCLES]) {
+            cout << "      IPC " << (double)totals.counts[p][PERF_INSTRUCTIONS] / totals.counts[p][PERF_CYCLES] << endl;
+        }
+    }
+    cout << defaultfloat << setprecision(6);
+}
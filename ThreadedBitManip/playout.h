@@ -0,0 +1,112 @@
+#pragma once
+
+/* Playout fast path. Most deals are solvable and many of them fall out of just playing pairs until none are left,
+  so before the exhaustive search a deal gets a few cheap playouts: no visited set, no backtracking, one line of play
+  from the deal to a dead end or the empty board. Only if every playout gets stuck does the full search run.
+  Playout 0 is greedy, it always plays the pair that uncovers the most buried cards. The others pick uniformly at
+  random among the available pairs. A failed playout proves nothing, so the answer is always the same as solve()'s.
+*/
+
+#include <chrono>
+#include <cstdint>
+
+#include "solver.h"
+
+// the most playouts a deal gets, the wins per playout are counted up to here
+const int MAX_PLAYOUTS = 64;
+
+// counters for tuning the number of playouts, per thread and then summed for the report
+struct PlayoutCounters {
+    uint64_t deals;           // deals that reached the playouts (past the three jacks check)
+    uint64_t playouts;        // playouts run
+    uint64_t playoutMoves;    // pairs played in them
+    uint64_t playoutNanos;    // time in the playout phase
+    uint64_t wins[MAX_PLAYOUTS]; // deals first cleared by playout i
+    uint64_t searches;        // deals every playout failed on, which went to the full search
+    uint64_t searchSolvable;  // of those, how many the search solved anyway
+    uint64_t searchNanos;     // time in the search phase
+};
+
+// helper for the playouts' random choices, xorshift64
+inline uint64_t nextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/* plays one line of pairs from state until nothing can be played. Greedy plays the pair whose piles have the most
+  cards left, otherwise a random pair is chosen. Returns true if it cleared the board. */
+bool playout(GameState state, bool greedy, uint64_t& random, uint64_t& moves) {
+    PlayoutMove options[MAX_MOVES];
+    for (;;) {
+        int count = listMoves(state, options);
+        int best = 0, bestScore = -1;
+        if (count == 0) break;
+        if (greedy) {
+            for (int m = 0; m < count; ++m) {
+                int score = packedCardCount(state.piles[options[m].a])
+                    + (options[m].b < NUM_PILES ? packedCardCount(state.piles[options[m].b]) : 1);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = m;
+                }
+            }
+        } else {
+            best = static_cast<int>(nextRandom(random) % count);
+        }
+        applyMove(state, options[best]);
+        moves++;
+    }
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (state.piles[i] != 0xFFFFFFFFu) return false;
+    }
+    return getTopReserveCard(&state) == 15;
+}
+
+/* the first phase: runs up to numPlayouts playouts and returns true if one of them cleared the board. The caller runs
+  its full search if not (checkDeal in main.cpp, which counts it in searches). random is the caller's generator state
+  (any nonzero value) */
+bool solvedByPlayouts(const GameState& state, int numPlayouts, uint64_t& random, PlayoutCounters& counters) {
+    auto start = chrono::steady_clock::now();
+    counters.deals++;
+    bool solved = false;
+    for (int p = 0; p < numPlayouts && p < MAX_PLAYOUTS && !solved; ++p) {
+        counters.playouts++;
+        if (playout(state, p == 0, random, counters.playoutMoves)) {
+            counters.wins[p]++;
+            solved = true;
+        }
+    }
+    counters.playoutNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    return solved;
+}
+
+void addPlayoutCounters(PlayoutCounters& into, const PlayoutCounters& from) {
+    into.deals += from.deals;
+    into.playouts += from.playouts;
+    into.playoutMoves += from.playoutMoves;
+    into.playoutNanos += from.playoutNanos;
+    for (int p = 0; p < MAX_PLAYOUTS; ++p) {
+        into.wins[p] += from.wins[p];
+    }
+    into.searches += from.searches;
+    into.searchSolvable += from.searchSolvable;
+    into.searchNanos += from.searchNanos;
+}
+
+// prints how the deals split between the phases, what each cost, and how many deals each playout cleared
+void printPlayoutCounters(const PlayoutCounters& counters, int numPlayouts) {
+    uint64_t won = counters.deals - counters.searches;
+    cout << "Playout phase: " << counters.playouts << " playouts (" << counters.playoutMoves << " pairs played) cleared "
+        << won << " of " << counters.deals << " deals in " << counters.playoutNanos / 1000000 << " milliseconds";
+    if (counters.playouts) cout << ", " << counters.playoutNanos / counters.playouts << " ns per playout";
+    cout << endl;
+    cout << "Search phase: " << counters.searches << " deals, " << counters.searchSolvable << " of them solvable, in "
+        << counters.searchNanos / 1000000 << " milliseconds" << endl;
+    cout << "Deals cleared by playout:";
+    for (int p = 0; p < numPlayouts && p < MAX_PLAYOUTS; ++p) {
+        cout << " " << counters.wins[p];
+    }
+    cout << endl;
+}
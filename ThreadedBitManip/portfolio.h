@@ -0,0 +1,195 @@
+#pragma once
+
+/* Portfolio solving for the escalation tier. How long solve() takes on a deal depends mostly on which move it tries
+  first: on a solvable deal one order finds a solution in a few hundred nodes while another wanders through millions
+  of dead positions first. So instead of splitting one search between the threads (see parallelSolver.h), every
+  thread runs its own complete search of the same deal with a different move order, and the first one to finish
+  sets a shared flag that stops the others. Every member is an exhaustive search with its own visited set, so
+  whichever finishes first has the exact answer, solvable or not.
+  The members run on the solver's own worker pool (see workerPool.h), started with it and parked between deals, so
+  every member has a thread of its own however many cores there are and no threads are started per deal.
+  Members 0 to 3 use fixed orders, the rest shuffle the moves at every node with their own seed.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "solver.h"
+#include "interleave.h"
+#include "playout.h"
+#include "workerPool.h"
+
+// the most members a portfolio can have, wins are counted per member up to here
+const int MAX_PORTFOLIO = 16;
+
+enum MoveOrder { SOLVE_ORDER, REVERSED_ORDER, RESERVE_FIRST_ORDER, DEEPEST_FIRST_ORDER, RANDOM_ORDER };
+const char* const MOVE_ORDER_NAMES[] = { "solve() order", "reversed", "reserve first", "deepest piles first", "random" };
+
+// helper to get the move order of portfolio member m
+inline MoveOrder memberOrder(int m) {
+    return m < RANDOM_ORDER ? static_cast<MoveOrder>(m) : RANDOM_ORDER;
+}
+
+// statistics of the escalation tier, which member finished each deal first and what the searches cost
+struct PortfolioStats {
+    uint64_t deals;
+    uint64_t wins[MAX_PORTFOLIO];
+    uint64_t winnerNodes;  // nodes expanded by the winning members
+    uint64_t totalNodes;   // nodes expanded by all members, including the ones that were stopped
+};
+
+// one member's search, kept between deals so its table is only allocated once
+struct PortfolioWorker {
+    MoveOrder order;
+    uint64_t random;
+    LaneTable table;
+    uint64_t nodes;
+    bool stopped;
+    const atomic<bool>* stop;
+};
+
+// helper to put a worker's moves into its order
+void orderMoves(GameState& state, PlayoutMove moves[], int count, PortfolioWorker& worker) {
+    switch (worker.order) {
+    case SOLVE_ORDER:
+        break;
+    case REVERSED_ORDER:
+        reverse(moves, moves + count);
+        break;
+    case RESERVE_FIRST_ORDER:
+        stable_partition(moves, moves + count, [](const PlayoutMove& move) { return move.b == NUM_PILES; });
+        break;
+    case DEEPEST_FIRST_ORDER:
+        // the same score as the greedy playout, the cards left in the piles the move uncovers
+        stable_sort(moves, moves + count, [&state](const PlayoutMove& x, const PlayoutMove& y) {
+            int scoreX = packedCardCount(state.piles[x.a]) + (x.b < NUM_PILES ? packedCardCount(state.piles[x.b]) : 1);
+            int scoreY = packedCardCount(state.piles[y.a]) + (y.b < NUM_PILES ? packedCardCount(state.piles[y.b]) : 1);
+            return scoreX > scoreY;
+        });
+        break;
+    case RANDOM_ORDER:
+        for (int m = count - 1; m > 0; --m) {
+            swap(moves[m], moves[nextRandom(worker.random) % (m + 1)]);
+        }
+        break;
+    }
+}
+
+// the same search as solve() in the worker's move order. Gives up (and sets worker.stopped) once the stop flag is set
+bool solvePortfolioMember(GameState& state, PortfolioWorker& worker) {
+    bool allEmpty = true;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (getTopPileCard(&state, i) != 15) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == 15) return true;
+
+    if (worker.stop->load(memory_order_relaxed)) {
+        worker.stopped = true;
+        return false;
+    }
+    uint32_t key = stateKey(state);
+    if (!worker.table.insertAt(key, worker.table.slotFor(key))) return false;
+    worker.nodes++;
+
+    PlayoutMove moves[MAX_MOVES];
+    int count = listMoves(state, moves);
+    orderMoves(state, moves, count, worker);
+    for (int m = 0; m < count; ++m) {
+        int card1 = removeTopPileCard(&state, moves[m].a);
+        int card2 = moves[m].b < NUM_PILES ? removeTopPileCard(&state, moves[m].b) : removeTopReserveCard(&state);
+        if (solvePortfolioMember(state, worker)) return true;
+        addPileCard(&state, moves[m].a, card1);
+        if (moves[m].b < NUM_PILES) {
+            addPileCard(&state, moves[m].b, card2);
+        } else {
+            addReserveCard(&state, card2);
+        }
+        if (worker.stopped) return false;
+    }
+    return false;
+}
+
+class PortfolioSolver {
+public:
+    // width members, the caller's thread runs member 0 and a pool worker each of the others
+    explicit PortfolioSolver(int width) : workers(min(max(width, 1), MAX_PORTFOLIO)), pool(static_cast<int>(workers.size()) - 1), stats() {
+        for (size_t m = 0; m < workers.size(); ++m) {
+            workers[m].order = memberOrder(static_cast<int>(m));
+            workers[m].random = mix64(m + 1);
+            workers[m].table.init(LANE_TABLE_LOG2);
+        }
+    }
+
+    // returns true if the deal can be cleared, racing every member on it
+    bool solve(const GameState& deal) {
+        GameState first = deal;
+        if (hasThreeJacks(&first)) return false;
+        atomic<bool> stop(false);
+        atomic<int> winner(-1);
+        bool solvable = false;
+        for (PortfolioWorker& worker : workers) {
+            worker.table.reset();
+            worker.nodes = 0;
+            worker.stopped = false;
+            worker.stop = &stop;
+        }
+        // the helper number is the member, each one runs a single turn
+        pool.run([&](int m) {
+            PortfolioWorker& worker = workers[m];
+            GameState state = deal;
+            bool result = solvePortfolioMember(state, worker);
+            int none = -1;
+            if (!worker.stopped && winner.compare_exchange_strong(none, m)) {
+                solvable = result;
+                stop.store(true, memory_order_relaxed);
+            }
+            return false;
+        }, pool.size());
+        stats.deals++;
+        stats.wins[winner.load()]++;
+        stats.winnerNodes += workers[winner.load()].nodes;
+        for (const PortfolioWorker& worker : workers) {
+            stats.totalNodes += worker.nodes;
+        }
+        return solvable;
+    }
+
+    int width() const { return static_cast<int>(workers.size()); }
+    const PortfolioStats& statistics() const { return stats; }
+
+private:
+    vector<PortfolioWorker> workers;
+    WorkerPool pool;
+    PortfolioStats stats;
+};
+
+/* The escalation tier as a portfolio: solves every parked deal by racing width move orders on it.
+  Returns how many are unsolvable, like solveOverflow() (see budget.h) */
+int solveOverflowPortfolio(const vector<GameState>& overflow, PortfolioSolver& solver, vector<size_t>* unsolvableDeals = nullptr) {
+    int unsolvable = 0;
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        if (!solver.solve(overflow[i])) {
+            unsolvable++;
+            if (unsolvableDeals) unsolvableDeals->push_back(i);
+        }
+    }
+    return unsolvable;
+}
+
+// prints how often each member finished first and how much work the race cost
+void printPortfolioStats(const PortfolioSolver& solver) {
+    const PortfolioStats& stats = solver.statistics();
+    cout << "Portfolio of " << solver.width() << " on " << stats.deals << " deals, wins by member:";
+    for (int m = 0; m < solver.width(); ++m) {
+        cout << " " << MOVE_ORDER_NAMES[memberOrder(m)];
+        if (memberOrder(m) == RANDOM_ORDER) cout << " " << m - RANDOM_ORDER + 1;
+        cout << " " << stats.wins[m] << (m + 1 < solver.width() ? "," : "");
+    }
+    cout << endl;
+    cout << "Nodes expanded by the winners: " << stats.winnerNodes << ", by all members: " << stats.totalNodes << endl;
+}
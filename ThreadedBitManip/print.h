@@ -12,33 +12,36 @@
 
 using namespace std;
 
-const int NUM_PILES = 10;
-const int PILE_SIZE = 5;
-const int RESERVE_SIZE = 2;
+// the standard layout, see rules.h for the variants
+const int NUM_PILES = StandardRules::numPiles;
+const int PILE_SIZE = StandardRules::pileSize;
+const int RESERVE_SIZE = StandardRules::reserveSize;
 
 // Helper function to convert a given game state's piles into a vector of integer vectors (2D vector)
-vector<vector<int>> convertPilesToVector(const GameState& state) {
-    vector<vector<int>> piles(NUM_PILES);
-    for (int i = 0; i < NUM_PILES; ++i) {
-        for (int j = 0; j < PILE_SIZE; ++j) {
-            int card = (state.piles[i] >> (j * 4)) & 0x0F;
-            if (card != 0x0F) {
+template <class Rules>
+vector<vector<int>> convertPilesToVector(const BasicGameState<Rules>& state) {
+    vector<vector<int>> piles(Rules::numPiles);
+    for (int i = 0; i < Rules::numPiles; ++i) {
+        for (int j = 0; j < Rules::pileSize; ++j) {
+            int card = static_cast<int>(state.piles[i] >> (j * Rules::cardBits)) & Rules::emptyCard;
+            if (card != Rules::emptyCard) {
                 piles[i].push_back(card);
             }
         }
     }
-    for (int i = 0; i < NUM_PILES; ++i) {
+    for (int i = 0; i < Rules::numPiles; ++i) {
         std::reverse(piles[i].begin(), piles[i].end());
     }
     return piles;
 }
 
 // Helper function to convert a given game state's reserve into a vector of integers
-vector<int> convertReserveToVector (const GameState& state) {
+template <class Rules>
+vector<int> convertReserveToVector (const BasicGameState<Rules>& state) {
     vector<int> reserve;
-    for (int i = 0; i < RESERVE_SIZE; ++i) {
-        int card = (state.reserve >> (i * 4)) & 0x0F;
-        if (card != 0x0F) {
+    for (int i = 0; i < Rules::reserveSize; ++i) {
+        int card = static_cast<int>(state.reserve >> (i * Rules::cardBits)) & Rules::emptyCard;
+        if (card != Rules::emptyCard) {
             reserve.push_back(card);
         }
     }
@@ -47,7 +50,8 @@ vector<int> convertReserveToVector (const GameState& state) {
 }
 
 // Function to print the entire game state
-void printGameState(const GameState& state) {
+template <class Rules>
+void printGameState(const BasicGameState<Rules>& state) {
     // Convert the state into a 2D vector
     vector<vector<int>> piles = convertPilesToVector(state);
     vector<int> reserve = convertReserveToVector(state);
@@ -0,0 +1,119 @@
+#pragma once
+
+/* Compile time rules and layout policies. The game state, the move helpers in solver.h and solve() are templated
+  on one of these, so a variant (different pile counts or reserve size, a reduced deck, another pairing rule)
+  is just another instantiation, and every number below is a compile time constant that folds away exactly like
+  the hand written 10 / 5 / 0x0F did.
+
+  A rules policy is GameRules<piles, cards per pile, reserve size, Cards>, where Cards says what a card is:
+    cardBits        - bits per card in the packed words, 4 for rank only cards, 8 for anything needing more than 15 values
+    card(i)         - the card value for index i (0 .. deckSize - 1) of a shuffled deck
+    isPair(a, b)    - the pairing rule
+    selfPairedCard  - a card that only pairs with itself (the jack in the standard game), -1 if there is none
+    deadPileCount   - how many self paired cards in one pile make a deal unsolvable, 0 to skip that check
+  The pile and reserve words are the smallest unsigned type that holds every slot (32 or 64 bit pile words),
+  and the all ones card value is the empty slot sentinel, 0x0F for 4 bit cards.
+*/
+
+#include <cstdint>
+#include <type_traits>
+
+// helper to pick the smallest unsigned word that holds the given number of bits
+template <int bits>
+struct PackedWord {
+    typedef typename std::conditional<(bits <= 8), uint8_t,
+        typename std::conditional<(bits <= 16), uint16_t,
+        typename std::conditional<(bits <= 32), uint32_t, uint64_t>::type>::type>::type type;
+};
+
+// the standard Gay Gordons pairs:
+/*0-12: 0 (ace) + 9 (10) = 9.
+    1       1 (2) + 8 (9) = 9.
+    2       2 (3)+ 7(8) = 9
+    3       3 (4) + 6 (7) = 9
+    4       4 (5) + 5 (6) = 9
+    5       5 (6) + 4 (5) = 9
+    plus king with queen and jack with jack
+    */
+struct ElevenPairs {
+    static const int cardBits = 4;
+    static const int selfPairedCard = 10;
+    static const int deadPileCount = 3;
+    static int card(int deckIndex) {
+        return deckIndex % 13;
+    }
+    static bool isPair(int card1, int card2) {
+        if ((card1 + card2 == 9) || (card1 == 12 && card2 == 11) || (card1 == 11 && card2 == 12) || (card1 == 10 && card2 == 10)) {
+            return true;
+        }
+        return false;
+    }
+};
+
+// pairs summing to 13 counting ace as 1 and queen as 12 (0-based ranks summing to 11), kings pair with kings
+struct ThirteenPairs {
+    static const int cardBits = 4;
+    static const int selfPairedCard = 12;
+    static const int deadPileCount = 3;
+    static int card(int deckIndex) {
+        return deckIndex % 13;
+    }
+    static bool isPair(int card1, int card2) {
+        return (card1 + card2 == 11) || (card1 == 12 && card2 == 12);
+    }
+};
+
+/* the standard pairs, but both cards must also be the same colour. A card is rank * 2 + colour, which needs
+  more than 4 bits, so these use 8 bit cards and 64 bit pile words. Jacks still pair with jacks, but only with the
+  one other jack of their colour, so there is no three jacks check.
+*/
+struct SameColourPairs {
+    static const int cardBits = 8;
+    static const int selfPairedCard = -1;
+    static const int deadPileCount = 0;
+    static int card(int deckIndex) {
+        // deck indices are suit major (0-12 first suit, 13-25 second, ...), suits alternate colour
+        return (deckIndex % 13) * 2 + ((deckIndex / 13) & 1);
+    }
+    static bool isPair(int card1, int card2) {
+        return ((card1 ^ card2) & 1) == 0 && ElevenPairs::isPair(card1 >> 1, card2 >> 1);
+    }
+};
+
+/* a reduced deck for exhaustive checks: two copies each of ace, 10, 2, 9, queen, king and jack (14 cards),
+  paired with the standard rule. Only two jacks, so no three jacks check.
+*/
+struct ReducedElevenPairs {
+    static const int cardBits = 4;
+    static const int selfPairedCard = -1;
+    static const int deadPileCount = 0;
+    static int card(int deckIndex) {
+        static const int ranks[7] = { 0, 9, 1, 8, 11, 12, 10 };
+        return ranks[deckIndex % 7];
+    }
+    static bool isPair(int card1, int card2) {
+        return ElevenPairs::isPair(card1, card2);
+    }
+};
+
+template <int NumPiles, int PileSize, int ReserveSize, class Cards>
+struct GameRules : Cards {
+    static const int numPiles = NumPiles;
+    static const int pileSize = PileSize;
+    static const int reserveSize = ReserveSize;
+    static const int deckSize = NumPiles * PileSize + ReserveSize;
+    static const int emptyCard = (1 << Cards::cardBits) - 1;
+
+    typedef typename PackedWord<(PileSize * Cards::cardBits <= 32 ? 32 : 64)>::type PileWord;
+    typedef typename PackedWord<ReserveSize * Cards::cardBits>::type ReserveWord;
+    static const int pileWordBits = sizeof(PileWord) * 8;
+    static const int reserveWordBits = sizeof(ReserveWord) * 8;
+
+    static_assert(PileSize * Cards::cardBits <= 64, "a pile has to fit in a 64 bit word");
+    static_assert(ReserveSize * Cards::cardBits <= 64, "the reserve has to fit in a 64 bit word");
+};
+
+typedef GameRules<10, 5, 2, ElevenPairs> StandardRules;
+typedef GameRules<10, 5, 2, ThirteenPairs> ThirteenRules;
+typedef GameRules<10, 5, 2, SameColourPairs> SameColourRules;
+typedef GameRules<4, 3, 2, ReducedElevenPairs> ReducedDeckRules;
@@ -0,0 +1,195 @@
+// No #pragma once: cpuDispatch.h includes this once per instruction set, each time inside its own namespace and with
+// KERNEL_LEVEL set, 0 for plain C++, 1 for AVX2 and 2 for AVX-512 (F, BW and VL). The hot kernels of the search are
+// written out per level, everything around them is the same code compiled for each level's target.
+
+/* the hash of GameStateHasher, with the same value at every level so the tables stay interchangeable:
+  every pile rotated left by its index and all of it xored together, then the reserve rotated by 10 */
+inline uint32_t hashState(const GameState& state) {
+#if KERNEL_LEVEL == 2
+    // all ten piles in one register, the other six lanes load as zero and rotate to zero
+    const __m512i rotations = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0, 0, 0, 0, 0);
+    __m512i rotated = _mm512_rolv_epi32(_mm512_maskz_loadu_epi32(0x3FF, state.piles), rotations);
+    __m256i folded = _mm256_xor_si256(_mm512_castsi512_si256(rotated), _mm512_extracti64x4_epi64(rotated, 1));
+#elif KERNEL_LEVEL == 1
+    // piles 0-7 in one register, AVX2 has no rotate so it is two variable shifts (a shift by 32 gives 0)
+    const __m256i rotations = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i counterRotations = _mm256_setr_epi32(32, 31, 30, 29, 28, 27, 26, 25);
+    __m256i piles = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.piles));
+    __m256i folded = _mm256_or_si256(_mm256_sllv_epi32(piles, rotations), _mm256_srlv_epi32(piles, counterRotations));
+#endif
+#if KERNEL_LEVEL >= 1
+    __m128i x = _mm_xor_si128(_mm256_castsi256_si128(folded), _mm256_extracti128_si256(folded, 1));
+    x = _mm_xor_si128(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_xor_si128(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t hash = static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+#if KERNEL_LEVEL == 1
+    hash ^= rotl32(state.piles[8], 8) ^ rotl32(state.piles[9], 9);
+#endif
+#else
+    uint32_t hash = 0;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        hash ^= rotl32(state.piles[i], i);
+    }
+#endif
+    return hash ^ rotl32(state.reserve, 10);
+}
+
+struct KernelHasher {
+    size_t operator()(const GameState& state) const {
+        return hashState(state);
+    }
+};
+
+typedef unordered_set<GameState, KernelHasher> KernelVisitedSet;
+// the library's visited set (see numa.h), with this level's hash
+typedef unordered_set<GameState, KernelHasher, equal_to<GameState>, ArenaAllocator<GameState>> KernelArenaVisitedSet;
+
+/* the prefilter, hasThreeJacks(): true if any pile holds three (or four) jacks */
+inline bool kernelThreeJacks(const GameState& state) {
+#if KERNEL_LEVEL >= 1
+    const int jack = StandardRules::selfPairedCard;
+#if KERNEL_LEVEL == 2
+    __m512i piles = _mm512_maskz_loadu_epi32(0x3FF, state.piles);
+    const __m512i nibble = _mm512_set1_epi32(0x0F), jacks = _mm512_set1_epi32(jack);
+    __m512i count = _mm512_setzero_si512();
+    for (int d = 0; d < PILE_SIZE; ++d) {
+        __mmask16 isJack = _mm512_cmpeq_epi32_mask(_mm512_and_si512(_mm512_srli_epi32(piles, 4 * d), nibble), jacks);
+        count = _mm512_mask_add_epi32(count, isJack, count, _mm512_set1_epi32(1));
+    }
+    return _mm512_cmpge_epi32_mask(count, _mm512_set1_epi32(StandardRules::deadPileCount)) != 0;
+#else
+    __m256i piles = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.piles));
+    const __m256i nibble = _mm256_set1_epi32(0x0F), jacks = _mm256_set1_epi32(jack);
+    __m256i count = _mm256_setzero_si256();
+    for (int d = 0; d < PILE_SIZE; ++d) {
+        // a match is -1, so subtracting counts it
+        count = _mm256_sub_epi32(count, _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srli_epi32(piles, 4 * d), nibble), jacks));
+    }
+    if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(count, _mm256_set1_epi32(StandardRules::deadPileCount - 1)))) return true;
+    for (int i = 8; i < NUM_PILES; ++i) {
+        int jackCount = 0;
+        for (int d = 0; d < PILE_SIZE; ++d) {
+            jackCount += ((state.piles[i] >> (4 * d)) & 0x0F) == uint32_t(jack);
+        }
+        if (jackCount >= StandardRules::deadPileCount) return true;
+    }
+    return false;
+#endif
+#else
+    GameState copy = state;
+    return hasThreeJacks(&copy);
+#endif
+}
+
+/* move generation: masks[i] gets the piles after pile i that pair with it, masks[NUM_PILES] the piles that pair with
+  the reserve. Bits are pile numbers, so walking them from the bottom gives solve()'s move order */
+inline void pairMasks(const GameState& state, uint16_t masks[NUM_PILES + 1]) {
+#if KERNEL_LEVEL >= 1
+    // the top cards as bytes (piles, then the reserve, then empties), and what each one would have to meet
+#if KERNEL_LEVEL == 2
+    __m512i words = _mm512_mask_loadu_epi32(_mm512_set1_epi32(0x0F), 0x3FF, state.piles);
+    words = _mm512_mask_set1_epi32(words, 1 << NUM_PILES, state.reserve);
+    __m128i tops = _mm512_cvtepi32_epi8(_mm512_and_si512(words, _mm512_set1_epi32(0x0F)));
+#else
+    alignas(16) uint8_t topBytes[16];
+    for (int i = 0; i < NUM_PILES; ++i) {
+        topBytes[i] = static_cast<uint8_t>(state.piles[i] & 0x0F);
+    }
+    topBytes[NUM_PILES] = static_cast<uint8_t>(state.reserve & 0x0F);
+    for (int i = NUM_PILES + 1; i < 16; ++i) {
+        topBytes[i] = 0x0F;
+    }
+    __m128i tops = _mm_load_si128(reinterpret_cast<const __m128i*>(topBytes));
+#endif
+    alignas(16) uint8_t partners[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(partners),
+        _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(partnerTable().partner)), tops));
+    for (int i = 0; i <= NUM_PILES; ++i) {
+#if KERNEL_LEVEL == 2
+        uint32_t meets = _mm_cmpeq_epi8_mask(tops, _mm_set1_epi8(static_cast<char>(partners[i])));
+#else
+        uint32_t meets = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(tops, _mm_set1_epi8(static_cast<char>(partners[i])))));
+#endif
+        // piles after this one, or every pile for the reserve
+        uint32_t later = i < NUM_PILES ? ~((2u << i) - 1) : ~0u;
+        masks[i] = static_cast<uint16_t>(meets & later & ((1u << NUM_PILES) - 1));
+    }
+#else
+    GameState& s = const_cast<GameState&>(state);
+    for (int i = 0; i < NUM_PILES; ++i) {
+        masks[i] = 0;
+        int topCard1 = getTopPileCard(&s, i);
+        if (topCard1 == 15) continue;
+        for (int j = i + 1; j < NUM_PILES; ++j) {
+            int topCard2 = getTopPileCard(&s, j);
+            if (topCard2 != 15 && isPair(topCard1, topCard2)) masks[i] |= 1 << j;
+        }
+    }
+    masks[NUM_PILES] = 0;
+    int topReserve = getTopReserveCard(&s);
+    if (topReserve != 15) {
+        for (int i = 0; i < NUM_PILES; ++i) {
+            int topCard = getTopPileCard(&s, i);
+            if (topCard != 15 && isPair(topReserve, topCard)) masks[NUM_PILES] |= 1 << i;
+        }
+    }
+#endif
+}
+
+// the same search as solve(), in the same move order, on this level's kernels
+template <class VisitedSet>
+bool searchDeal(GameState& state, VisitedSet& visited) {
+    bool allEmpty = true;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        if (state.piles[i] != 0xFFFFFFFFu) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == 15) return true;
+
+    if (visited.find(state) != visited.end()) return false;
+    visited.insert(state);
+    uint16_t masks[NUM_PILES + 1];
+    pairMasks(state, masks);
+    for (int i = 0; i < NUM_PILES; ++i) {
+        for (uint32_t pairs = masks[i]; pairs; pairs &= pairs - 1) {
+            int j = lowestBit(pairs);
+            int card1 = removeTopPileCard(&state, i);
+            int card2 = removeTopPileCard(&state, j);
+            if (searchDeal(state, visited)) return true;
+            addPileCard(&state, i, card1);
+            addPileCard(&state, j, card2);
+        }
+    }
+    for (uint32_t pairs = masks[NUM_PILES]; pairs; pairs &= pairs - 1) {
+        int i = lowestBit(pairs);
+        int card = removeTopPileCard(&state, i);
+        int reserve = removeTopReserveCard(&state);
+        if (searchDeal(state, visited)) return true;
+        addPileCard(&state, i, card);
+        addReserveCard(&state, reserve);
+    }
+    return false;
+}
+
+// isSolvable() on this level's kernels
+bool isSolvableDeal(GameState* state) {
+    if (kernelThreeJacks(*state)) return false;
+    KernelVisitedSet visited;
+    return searchDeal(*state, visited);
+}
+
+// the library's solveDeal() on this level's kernels: the visited set lives in the thread's arena, statesVisited gets its size
+bool solveInArena(GameState* state, Arena& arena, uint32_t* statesVisited) {
+    *statesVisited = 0;
+    if (kernelThreeJacks(*state)) return false;
+    bool solvable;
+    {
+        KernelArenaVisitedSet visited(64, KernelHasher(), equal_to<GameState>(), ArenaAllocator<GameState>(&arena));
+        solvable = searchDeal(*state, visited);
+        *statesVisited = static_cast<uint32_t>(visited.size());
+    }
+    resetArena(arena);
+    return solvable;
+}
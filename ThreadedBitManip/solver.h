@@ -1,68 +1,253 @@
 #pragma once
 
+#include <cstdint>
+#include <unordered_set>
+
 #include "gameState.h"
+#include "print.h"
 
-// helper function to check if two given cards are a pair
-/*0-12: 0 (ace) + 9 (10) = 9. 
-    1       1 (2) + 8 (9) = 9. 
-    2       2 (3)+ 7(8) = 9
-    3       3 (4) + 6 (7) = 9
-    4       4 (5) + 5 (6) = 9
-    5       5 (6) + 4 (5) = 9
-    */
+// helper function to check if two given cards are a pair under the standard rules (see ElevenPairs in rules.h)
 inline bool isPair(int card1, int card2) {
-    if ((card1 + card2 == 9) || (card1 == 12 && card2 == 11) || (card1 == 11 && card2 == 12) || (card1 == 10 && card2 == 10)) {
-        return true;
-    }
-    return false;
+    return StandardRules::isPair(card1, card2);
 }
 
+/* The move helpers below are templated on the rules (see rules.h), so they work on any variant's packed state.
+  Rules::emptyCard is the all ones card value, 15 (0x0F) for the standard 4 bit cards. */
+
 // helper function to print the in play (first) card from a given pile, return 15 if the column is empty
-inline int getTopPileCard(GameState* state, int column) {
-    int card = (state->piles[column] & 0x0F);
-    if (card == 0x0F) {
-        return 15;
+template <class Rules>
+inline int getTopPileCard(BasicGameState<Rules>* state, int column) {
+    int card = static_cast<int>(state->piles[column] & Rules::emptyCard);
+    if (card == Rules::emptyCard) {
+        return Rules::emptyCard;
     }
     return card;
 }
 
 // helper function to print the in play (first) card from reserve, return 15 if the reserve is empty
-inline int getTopReserveCard(GameState* state) {
-    int card = (state->reserve & 0x0F);
-    if (card == 0x0F) {
-        return 15;
+template <class Rules>
+inline int getTopReserveCard(BasicGameState<Rules>* state) {
+    int card = static_cast<int>(state->reserve & Rules::emptyCard);
+    if (card == Rules::emptyCard) {
+        return Rules::emptyCard;
     }
     return card;
 }
 
 /* helper function to remove the top card from a given pile, it returns the card it just removed, 15 if the column is empty. It shifts the remaining cards 
  to the left, and sets the new space to 0x0F.*/
-inline int removeTopPileCard(GameState* state, int column) {
-    int card = (state->piles[column] & 0x0F);
-    if (card == 0x0F) {
-        return 15;
+template <class Rules>
+inline int removeTopPileCard(BasicGameState<Rules>* state, int column) {
+    typedef typename Rules::PileWord PileWord;
+    int card = static_cast<int>(state->piles[column] & Rules::emptyCard);
+    if (card == Rules::emptyCard) {
+        return Rules::emptyCard;
     }
-    state->piles[column] = (state->piles[column] >> 4) | (0x0F << (4 * 7));
+    state->piles[column] = (state->piles[column] >> Rules::cardBits) | (PileWord(Rules::emptyCard) << (Rules::pileWordBits - Rules::cardBits));
     return card;
 }
 
 // helper function to remove the top card from reserve, it returns the card it just removed, 15 if the reserve is empty
 // it shifts the remaining cards to the left, and sets the new space to 0x0F
-inline int removeTopReserveCard(GameState* state) {
-    int card = (state->reserve & 0x0F);
-    if (card == 0x0F) {
-        return 15;
+template <class Rules>
+inline int removeTopReserveCard(BasicGameState<Rules>* state) {
+    typedef typename Rules::ReserveWord ReserveWord;
+    int card = static_cast<int>(state->reserve & Rules::emptyCard);
+    if (card == Rules::emptyCard) {
+        return Rules::emptyCard;
     }
-    state->reserve = (state->reserve >> 4) | (0x0F << (4 * 1));
+    state->reserve = (state->reserve >> Rules::cardBits) | (ReserveWord(Rules::emptyCard) << (Rules::reserveWordBits - Rules::cardBits));
     return card;
 }
 
 // helper function to add a card to a given pile
-inline void addPileCard(GameState* state, int column, int card) {
-    state->piles[column] = (state->piles[column] << 4) | card;
+template <class Rules>
+inline void addPileCard(BasicGameState<Rules>* state, int column, int card) {
+    typedef typename Rules::PileWord PileWord;
+    state->piles[column] = (state->piles[column] << Rules::cardBits) | PileWord(card);
 }
 
 //helper function to add a card to reserve
-inline void addReserveCard(GameState* state, int card) {
-    state->reserve = (state->reserve << 4) | card;
+template <class Rules>
+inline void addReserveCard(BasicGameState<Rules>* state, int card) {
+    typedef typename Rules::ReserveWord ReserveWord;
+    state->reserve = (state->reserve << Rules::cardBits) | ReserveWord(card);
+}
+
+// a pair that can be played: two piles, or a pile and the reserve (b == NUM_PILES)
+struct PlayoutMove {
+    int8_t a;
+    int8_t b;
+};
+
+// the most moves a state can have, every pile pair and every pile with the reserve
+const int MAX_MOVES = NUM_PILES * (NUM_PILES + 1) / 2;
+
+// helper to list the moves of a state in solve()'s order, pile pairs first, then the reserve (b == NUM_PILES)
+inline int listMoves(GameState& state, PlayoutMove moves[]) {
+    int count = 0;
+    for (int i = 0; i < NUM_PILES; ++i) {
+        int topCard1 = getTopPileCard(&state, i);
+        if (topCard1 == 15) continue;
+        for (int j = i + 1; j < NUM_PILES; ++j) {
+            int topCard2 = getTopPileCard(&state, j);
+            if (topCard2 != 15 && isPair(topCard1, topCard2)) {
+                moves[count++] = PlayoutMove{ int8_t(i), int8_t(j) };
+            }
+        }
+    }
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve != 15) {
+        for (int i = 0; i < NUM_PILES; ++i) {
+            int topCard = getTopPileCard(&state, i);
+            if (topCard != 15 && isPair(topReserve, topCard)) {
+                moves[count++] = PlayoutMove{ int8_t(i), int8_t(NUM_PILES) };
+            }
+        }
+    }
+    return count;
+}
+
+// helper to play a move on a state
+inline void applyMove(GameState& state, const PlayoutMove& move) {
+    removeTopPileCard(&state, move.a);
+    if (move.b < NUM_PILES) {
+        removeTopPileCard(&state, move.b);
+    } else {
+        removeTopReserveCard(&state);
+    }
+}
+
+// the parts of checking a deal, for instrumentation (see phaseProfile.h)
+enum SolverPhase {
+    PHASE_DEAL,       // generating or loading the deal
+    PHASE_PREFILTER,  // the three jacks check
+    PHASE_MOVEGEN,    // the solved check and finding the pairs to play
+    PHASE_VISITED,    // visited set lookup and insert
+    PHASE_BACKTRACK,  // putting the cards back after a move fails
+    PHASE_COUNT
+};
+
+/* the probe solve() uses when none is given, every call compiles to nothing. Probes derive from it and hide the hooks
+  they need: enter() and node() for instrumentation, prune() to cut a state that can't be cleared before its visited
+  lookup, expand() to give up on a state once it is in the visited set (false abandons it) and stopped() to unwind
+  the whole search after a failed move, for budgets. removed() and added() follow every card that leaves or goes back
+  to a slot, a pile or the reserve (slot numPiles) */
+struct NoProbe {
+    void enter(SolverPhase) {}
+    void node() {}
+    template <class State>
+    bool prune(const State&) { return false; }
+    bool expand() { return true; }
+    bool stopped() { return false; }
+    void removed(int, int) {}
+    void added(int, int) {}
+};
+
+/* VisitedSet is normally unordered_set<BasicGameState<Rules>, BasicGameStateHasher<Rules>>, anything with find and insert works.
+  The probe is told about every node and every change of phase, and can cut or stop the search (see NoProbe) */
+template <class Rules, class VisitedSet, class Probe>
+bool solve (BasicGameState<Rules>& state, VisitedSet& visited, Probe& probe) {
+    probe.node();
+    probe.enter(PHASE_MOVEGEN);
+    bool allEmpty = true;
+    for (int i = 0; i < Rules::numPiles; ++i) {
+        if (getTopPileCard(&state, i) != Rules::emptyCard) {
+            allEmpty = false;
+            break;
+        }
+    }
+    if (allEmpty && getTopReserveCard(&state) == Rules::emptyCard) return true;
+    if (probe.prune(state)) return false;
+
+    probe.enter(PHASE_VISITED);
+    if (visited.find(state) != visited.end()) return false;
+    visited.insert(state);
+    if (!probe.expand()) return false;
+    probe.enter(PHASE_MOVEGEN);
+    // try to find a valid pair from piles
+    for (int i = 0; i < Rules::numPiles; ++i) {
+        int topCard1 = getTopPileCard(&state, i);
+        if (topCard1 != Rules::emptyCard) {
+            for (int j = i + 1; j < Rules::numPiles; ++j) {
+                int topCard2 = getTopPileCard(&state, j);
+                if (topCard2 != Rules::emptyCard && Rules::isPair(topCard1, topCard2)) {
+                    int card1 = removeTopPileCard(&state, i);
+                    int card2 = removeTopPileCard(&state, j);
+                    probe.removed(card1, i);
+                    probe.removed(card2, j);
+                    if (solve(state, visited, probe)) return true;
+                    probe.enter(PHASE_BACKTRACK);
+                    addPileCard(&state, i, card1);
+                    addPileCard(&state, j, card2);
+                    probe.added(card1, i);
+                    probe.added(card2, j);
+                    if (probe.stopped()) return false;
+                    probe.enter(PHASE_MOVEGEN);
+                }
+            }
+        }
+    }
+    // try to find a valid pair between reserve and piles
+    int topReserve = getTopReserveCard(&state);
+    if (topReserve != Rules::emptyCard) {
+        for (int i = 0; i < Rules::numPiles; ++i) {
+            int topCard = getTopPileCard(&state, i);
+            if (topCard != Rules::emptyCard && Rules::isPair(topReserve, topCard)) {
+                int card = removeTopPileCard(&state, i);
+                int reserve = removeTopReserveCard(&state);
+                probe.removed(card, i);
+                probe.removed(reserve, Rules::numPiles);
+                if (solve(state, visited, probe)) return true;
+                probe.enter(PHASE_BACKTRACK);
+                addPileCard(&state, i, card);
+                addReserveCard(&state, reserve);
+                probe.added(card, i);
+                probe.added(reserve, Rules::numPiles);
+                if (probe.stopped()) return false;
+                probe.enter(PHASE_MOVEGEN);
+            }
+        }
+    }
+    return false;
 }
+
+template <class Rules, class VisitedSet>
+bool solve (BasicGameState<Rules>& state, VisitedSet& visited) {
+    NoProbe probe;
+    return solve(state, visited, probe);
+}
+
+// inline helper function to see if any given pile has three jacks
+// (for other rules: Rules::deadPileCount of the card that only pairs with itself, see rules.h)
+template <class Rules>
+inline bool hasThreeJacks(BasicGameState<Rules>* state) {
+    if (Rules::deadPileCount == 0) return false;
+    for (int i = 0; i < Rules::numPiles; ++i) {;
+        int jackCount = 0;
+        typename Rules::PileWord pile = state->piles[i];
+        for (int j = 0; j < Rules::pileSize; ++j) {
+            //int card = pile >> (4 * i) & 0x0F;
+            int card = static_cast<int>(pile & Rules::emptyCard);
+            pile >>= Rules::cardBits;
+            if (card == Rules::selfPairedCard) {
+                jackCount++;
+                if (jackCount >= Rules::deadPileCount) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// function which check to see if a state is solvable
+template <class Rules>
+bool isSolvable(BasicGameState<Rules>* state) {
+    unordered_set<BasicGameState<Rules>, BasicGameStateHasher<Rules>> visited;
+    if (hasThreeJacks(state)) { 
+        //std::cout << "Impossible to solve (3 Jacks in a stack)." << std::endl; 
+        return false; 
+    }
+    return solve(*state, visited);
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+/* A resident solver: keeps the library's worker pool and scratch warm and answers "which of these deals are solvable?"
+  requests over a Unix domain socket, or over stdin/stdout (handy for tests and for running under another process).
+  Build it together with the library, e.g.  g++ -O2 solverDaemon.cpp solverLibrary.cpp -pthread -o solverDaemon
+  Usage:  solverDaemon <socket path> [threads]     or     solverDaemon - [threads]   for stdin/stdout
+          solverDaemon --check [threads]   runs the fairness check below and exits, 0 if it passed
+
+  Protocol, all integers little endian (the host order on every machine we run on):
+    request   uint32 magic 'GGRQ', uint32 request id, uint32 deal count, then count deals of 52 bytes (card indices 0-51)
+    response  uint32 magic 'GGRS', uint32 request id, uint32 deal count, uint32 unsolvable count,
+              uint64 microseconds from the request being read to its results being ready,
+              then one byte per deal, 1 if solvable, 0 if not
+  Each connection gets its responses in request order. A bad magic or a count over MAX_DEALS_PER_REQUEST closes the connection.
+
+  Backpressure: a connection only reads its next request after the previous response is written, so a client that
+  sends faster than it is served fills the socket buffer and blocks in send(). The daemon takes at most MAX_CLIENTS
+  connections at once, the rest wait in the listen queue. Requests from different connections are solved at the same
+  time, the pool's workers take their chunks in turns (see workerPool.h), so a small request isn't queued behind a big one.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "solverLibrary.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const uint32_t REQUEST_MAGIC = 0x51524747;  // "GGRQ"
+const uint32_t RESPONSE_MAGIC = 0x53524747; // "GGRS"
+const uint32_t MAX_DEALS_PER_REQUEST = 1 << 20;
+const int MAX_CLIENTS = 64;
+// the fairness check: deals per thread in the big batch, the one deal requests sent while it runs, and how long one may take
+const uint32_t CHECK_BIG_DEALS_PER_THREAD = 4096;
+const int CHECK_SMALL_REQUESTS = 20;
+const uint64_t CHECK_SMALL_LIMIT_MICROS = 200000;
+
+// a byte stream: a socket, or stdin/stdout. read and write return false once the stream is closed or broken
+struct Stream {
+    int inFd;
+    int outFd;
+};
+
+bool readFully(const Stream& stream, void* buffer, size_t bytes) {
+    char* out = static_cast<char*>(buffer);
+    while (bytes > 0) {
+#ifdef _WIN32
+        int got = _read(stream.inFd, out, static_cast<unsigned>(bytes));
+#else
+        ssize_t got = read(stream.inFd, out, bytes);
+#endif
+        if (got <= 0) return false;
+        out += got;
+        bytes -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool writeFully(const Stream& stream, const void* buffer, size_t bytes) {
+    const char* in = static_cast<const char*>(buffer);
+    while (bytes > 0) {
+#ifdef _WIN32
+        int sent = _write(stream.outFd, in, static_cast<unsigned>(bytes));
+#else
+        ssize_t sent = write(stream.outFd, in, bytes);
+#endif
+        if (sent <= 0) return false;
+        in += sent;
+        bytes -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+/* serves one client until it disconnects or sends something malformed. The deal and result buffers only grow,
+so a client sending same sized batches doesn't allocate per request */
+void serveClient(Stream stream, int numThreads) {
+    vector<gordons::Deal> deals;
+    vector<gordons::Result> results;
+    vector<uint8_t> response;
+    for (;;) {
+        uint32_t header[3];
+        if (!readFully(stream, header, sizeof(header))) return;
+        if (header[0] != REQUEST_MAGIC || header[2] > MAX_DEALS_PER_REQUEST) {
+            cerr << "Bad request header, closing connection." << endl;
+            return;
+        }
+        const uint32_t count = header[2];
+        if (deals.size() < count) {
+            deals.resize(count);
+            results.resize(count);
+        }
+        if (count && !readFully(stream, deals.data(), count * sizeof(gordons::Deal))) return;
+
+        auto start = chrono::steady_clock::now();
+        gordons::Options options = { numThreads };
+        gordons::solveBatch({ deals.data(), count }, { results.data(), count }, options);
+        uint64_t latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+        uint32_t unsolvable = 0;
+        response.resize(24 + count);
+        for (uint32_t i = 0; i < count; ++i) {
+            response[24 + i] = results[i].solvable ? 1 : 0;
+            unsolvable += !results[i].solvable;
+        }
+        uint32_t responseHeader[4] = { RESPONSE_MAGIC, header[1], count, unsolvable };
+        memcpy(response.data(), responseHeader, sizeof(responseHeader));
+        memcpy(response.data() + 16, &latency, sizeof(latency));
+        if (!writeFully(stream, response.data(), response.size())) return;
+    }
+}
+
+/* the fairness check: one thread solves a big batch of random deals while this one sends one deal batches, each timed
+  the way serveClient() times a request. They should come back in about the time their deal takes, not once the big batch
+  is done. Passes if every one is under CHECK_SMALL_LIMIT_MICROS and the big batch was still running when they finished */
+int checkFairness(int numThreads) {
+    mt19937 g(12345);
+    auto randomDeal = [&g] {
+        gordons::Deal deal;
+        for (int i = 0; i < 52; ++i) deal.cards[i] = static_cast<uint8_t>(i);
+        shuffle(deal.cards, deal.cards + 52, g);
+        return deal;
+    };
+    const uint32_t bigCount = CHECK_BIG_DEALS_PER_THREAD * static_cast<uint32_t>(numThreads > 0 ? numThreads : thread::hardware_concurrency());
+    vector<gordons::Deal> big(bigCount);
+    vector<gordons::Result> bigResults(bigCount);
+    for (gordons::Deal& deal : big) deal = randomDeal();
+    gordons::Options options = { numThreads };
+    atomic<bool> bigDone(false);
+    uint64_t bigMicros = 0;
+    thread bigClient([&] {
+        auto start = chrono::steady_clock::now();
+        gordons::solveBatch({ big.data(), big.size() }, { bigResults.data(), bigResults.size() }, options);
+        bigMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        bigDone = true;
+    });
+    // let the big batch get going
+    this_thread::sleep_for(chrono::milliseconds(50));
+    vector<uint64_t> latencies;
+    for (int r = 0; r < CHECK_SMALL_REQUESTS; ++r) {
+        gordons::Deal deal = randomDeal();
+        gordons::Result result;
+        auto start = chrono::steady_clock::now();
+        gordons::solveBatch({ &deal, 1 }, { &result, 1 }, options);
+        latencies.push_back(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+    }
+    bool overlapped = !bigDone;
+    bigClient.join();
+    sort(latencies.begin(), latencies.end());
+    uint64_t slowest = latencies.back();
+    cout << "Big batch: " << bigCount << " deals in " << bigMicros / 1000 << " ms" << endl;
+    cout << "One deal requests during it: median " << latencies[latencies.size() / 2] << " us, slowest " << slowest << " us" << endl;
+    if (slowest > CHECK_SMALL_LIMIT_MICROS) {
+        cout << "Fairness check FAILED." << endl;
+        return 1;
+    }
+    if (!overlapped) {
+        cout << "The big batch finished before the one deal requests did, the check didn't test anything." << endl;
+        return 1;
+    }
+    cout << "Fairness check passed." << endl;
+    return 0;
+}
+
+#ifndef _WIN32
+// accepts clients on a Unix domain socket, one thread per client, at most MAX_CLIENTS at a time
+int serveSocket(const string& path, int numThreads) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return 1;
+    }
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path too long." << endl;
+        return 1;
+    }
+    strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, MAX_CLIENTS) < 0) {
+        perror("bind/listen");
+        return 1;
+    }
+    cout << "Listening on " << path << endl;
+
+    mutex mtx;
+    condition_variable slotFree;
+    int clients = 0;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(mtx);
+            slotFree.wait(lock, [&] { return clients < MAX_CLIENTS; });
+        }
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) continue;
+        {
+            lock_guard<mutex> lock(mtx);
+            clients++;
+        }
+        thread([connection, numThreads, &mtx, &slotFree, &clients] {
+            serveClient(Stream{ connection, connection }, numThreads);
+            close(connection);
+            {
+                lock_guard<mutex> lock(mtx);
+                clients--;
+            }
+            slotFree.notify_one();
+        }).detach();
+    }
+}
+#endif
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <socket path | - | --check> [threads]" << endl;
+        return 1;
+    }
+    int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+    if (string(argv[1]) == "--check") {
+        return checkFairness(numThreads);
+    }
+    // warm the pool and this thread's scratch before the first request
+    gordons::Deal warmup;
+    for (int i = 0; i < 52; ++i) warmup.cards[i] = static_cast<uint8_t>(i);
+    gordons::Result warmResult;
+    gordons::Options options = { numThreads };
+    gordons::solveBatch({ &warmup, 1 }, { &warmResult, 1 }, options);
+
+    if (string(argv[1]) == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        serveClient(Stream{ 0, 1 }, numThreads);
+        return 0;
+    }
+#ifdef _WIN32
+    cerr << "Unix domain sockets aren't supported in this build, use - for stdin/stdout." << endl;
+    return 1;
+#else
+    signal(SIGPIPE, SIG_IGN);
+    return serveSocket(argv[1], numThreads);
+#endif
+}
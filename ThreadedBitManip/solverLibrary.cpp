@@ -0,0 +1,216 @@
+/* The solver as a library, see solverLibrary.h for the interface.
+  The solver headers are included inside this file's anonymous namespace, so their functions, globals and
+  `using namespace std` stay internal to the library and only gordons:: and gordons_* are exported. A program that links
+  the library can include the same headers itself (main.cpp, a test) without duplicate symbols.
+  The standard and system headers they use are included first, at file scope, so the solver headers' own includes of
+  them are no-ops inside the namespace. A header that starts using a new one has to be added here too.
+*/
+
+#include "solverLibrary.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+// the library uses a few of the headers' functions, the rest are internal and unused here
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "gameState.h"
+#include "print.h"
+#include "solver.h"
+#include "numa.h"
+#include "cpuDispatch.h"
+#include "hintEngine.h"
+#include "workerPool.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+// visited set storage kept by every thread that solves deals through the library
+const size_t LIBRARY_ARENA_BYTES = size_t(64) << 20;
+// deals a thread claims at a time from a batch
+const size_t BATCH_CHUNK = 16;
+
+// a thread's scratch, allocated on the thread's NUMA node the first time it solves a deal and freed when the thread exits
+struct ThreadScratch {
+    Arena arena;
+    ThreadScratch() {
+        initArena(arena, LIBRARY_ARENA_BYTES, true);
+    }
+    ~ThreadScratch() {
+        freeLocal(arena.block);
+    }
+};
+
+Arena& threadArena() {
+    thread_local ThreadScratch scratch;
+    return scratch.arena;
+}
+
+// one deal on the search kernels picked for this CPU (see cpuDispatch.h), with the visited set in the thread's arena
+gordons::Result solveDeal(const gordons::Deal& deal, Arena& arena) {
+    int deck[52];
+    for (int i = 0; i < 52; ++i) {
+        deck[i] = deal.cards[i] % 13;
+    }
+    GameState state = createGameState(deck);
+    gordons::Result result = { false, 0 };
+    result.solvable = searchKernels().solveInArena(&state, arena, &result.statesVisited);
+    return result;
+}
+
+// one batch being solved. Results go to results, or to flags (one byte per deal) for the C interface
+struct BatchJob {
+    const gordons::Deal* deals;
+    gordons::Result* results;
+    uint8_t* flags;
+    size_t count;
+    std::atomic<size_t> next;
+    std::atomic<size_t> unsolvable;
+};
+
+// one turn on a batch: claims the next chunk and solves it, returns false once there are no chunks left to claim
+bool solveChunk(BatchJob& job) {
+    size_t start = job.next.fetch_add(BATCH_CHUNK);
+    if (start >= job.count) return false;
+    size_t end = start + BATCH_CHUNK < job.count ? start + BATCH_CHUNK : job.count;
+    Arena& arena = threadArena();
+    size_t unsolvable = 0;
+    for (size_t i = start; i < end; ++i) {
+        gordons::Result result = solveDeal(job.deals[i], arena);
+        if (job.results) job.results[i] = result;
+        if (job.flags) job.flags[i] = result.solvable ? 1 : 0;
+        unsolvable += !result.solvable;
+    }
+    job.unsolvable.fetch_add(unsolvable);
+    return end < job.count;
+}
+
+/* the pool (see workerPool.h), started by the first batch with that batch's thread count. The calling thread works on
+  its own batch too, so a pool for n threads has n - 1 workers. Batches from several threads are open at the same time
+  and the workers take their chunks in turns, so a one deal request isn't stuck behind a million deal one */
+WorkerPool& pool(int numThreads) {
+    static WorkerPool instance((numThreads > 0 ? numThreads : static_cast<int>(std::thread::hardware_concurrency())) - 1);
+    return instance;
+}
+
+size_t runBatch(int numThreads, const gordons::Deal* deals, gordons::Result* results, uint8_t* flags, size_t count) {
+    BatchJob batch;
+    batch.deals = deals;
+    batch.results = results;
+    batch.flags = flags;
+    batch.count = count;
+    batch.next = 0;
+    batch.unsolvable = 0;
+    WorkerPool& workers = pool(numThreads);
+    size_t chunks = (count + BATCH_CHUNK - 1) / BATCH_CHUNK;
+    int helpers = static_cast<int>(chunks > 1 ? (chunks - 1 < size_t(workers.size()) ? chunks - 1 : workers.size()) : 0);
+    workers.run([&batch](int) { return solveChunk(batch); }, helpers);
+    return batch.unsolvable.load();
+}
+
+} // namespace
+
+namespace gordons {
+
+Result solve(const Deal& deal) {
+    return solveDeal(deal, threadArena());
+}
+
+void solveBatch(Span<const Deal> deals, Span<Result> results, const Options& options) {
+    size_t count = deals.size < results.size ? deals.size : results.size;
+    runBatch(options.numThreads, deals.data, results.data, nullptr, count);
+}
+
+struct HintSession::Session {
+    ::HintSession hints;
+    std::vector<PlayoutMove> played;
+    Session(const GameState& deal, size_t memoBytes) : hints(deal, memoBytes) {}
+};
+
+HintSession::HintSession(const Deal& deal, size_t memoBytes) {
+    int deck[52];
+    for (int i = 0; i < 52; ++i) {
+        deck[i] = deal.cards[i] % 13;
+    }
+    session = new Session(createGameState(deck), memoBytes);
+}
+
+HintSession::~HintSession() {
+    delete session;
+}
+
+bool HintSession::setPosition(Span<const Move> played) {
+    session->played.resize(played.size);
+    for (size_t m = 0; m < played.size; ++m) {
+        session->played[m] = PlayoutMove{ int8_t(played.data[m].a), int8_t(played.data[m].b) };
+    }
+    return session->hints.setPosition(session->played);
+}
+
+size_t HintSession::winningMoves(Span<Move> moves) {
+    std::vector<PlayoutMove> winning = session->hints.winningMoves();
+    size_t count = winning.size() < moves.size ? winning.size() : moves.size;
+    for (size_t m = 0; m < count; ++m) {
+        moves.data[m] = Move{ uint8_t(winning[m].a), uint8_t(winning[m].b) };
+    }
+    return winning.size();
+}
+
+void HintSession::end() {
+    session->hints.end();
+}
+
+} // namespace gordons
+
+extern "C" int gordons_solve(const uint8_t cards[52]) {
+    return gordons::solve(*reinterpret_cast<const gordons::Deal*>(cards)).solvable ? 1 : 0;
+}
+
+extern "C" size_t gordons_solve_batch(const uint8_t* cards, size_t count, uint8_t* results, int num_threads) {
+    static_assert(sizeof(gordons::Deal) == 52, "a C deal is 52 packed bytes");
+    return runBatch(num_threads, reinterpret_cast<const gordons::Deal*>(cards), nullptr, results, count);
+}
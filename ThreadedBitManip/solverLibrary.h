@@ -0,0 +1,93 @@
+#ifndef GAY_GORDONS_SOLVER_LIBRARY_H
+#define GAY_GORDONS_SOLVER_LIBRARY_H
+
+/* Public interface of the solver as a library, for linking into other programs.
+  This header only declares the API: it pulls in no solver headers, no `using namespace std` and no globals.
+  The implementation is solverLibrary.cpp, built as its own object/library, e.g. with MSVC:
+      cl /O2 /EHsc /c solverLibrary.cpp && lib solverLibrary.obj
+  A deal is the order of a shuffled deck, 52 card indices 0-51 (any value works, only value % 13 is used),
+  exactly one line of ../BenchmarkGen/benchmarkDecks.txt: the first 50 cards make the ten piles of five, the last two the reserve.
+
+  Batches are solved on a pool of worker threads that is started by the first batch call and kept for the life of
+  the process. Every worker keeps its own visited set storage (see numa.h) and reuses it for every deal, so solving
+  a deal doesn't allocate. Batch calls from several threads are safe and run at the same time, the workers take their
+  chunks of the open batches in turns.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* C ABI. gordons_solve returns 1 if the deal is solvable, 0 if not.
+  gordons_solve_batch solves count deals (52 bytes each, back to back) and writes 1 or 0 per deal to results,
+  using up to num_threads threads (0 for one per hardware thread). Returns the number of unsolvable deals. */
+int gordons_solve(const uint8_t cards[52]);
+size_t gordons_solve_batch(const uint8_t* cards, size_t count, uint8_t* results, int num_threads);
+
+#ifdef __cplusplus
+}
+
+namespace gordons {
+
+struct Deal {
+    uint8_t cards[52];
+};
+
+struct Result {
+    bool solvable;
+    uint32_t statesVisited;
+};
+
+struct Options {
+    int numThreads; // 0 for one per hardware thread (the first call fixes the pool size)
+};
+
+// a pointer and a length, standing in for std::span so the header also builds as C++14
+template <class T>
+struct Span {
+    T* data;
+    size_t size;
+};
+
+// solves one deal on the calling thread, reusing that thread's scratch
+Result solve(const Deal& deal);
+
+// solves deals.size deals into results (which must be at least as long) on the worker pool
+void solveBatch(Span<const Deal> deals, Span<Result> results, const Options& options);
+
+// a move: pile a (0-9) with pile b, or with the reserve when b is 10
+struct Move {
+    uint8_t a;
+    uint8_t b;
+};
+
+/* Hints for one game in progress: which moves keep it winnable. The session keeps every position it solves in a memo
+  of at most memoBytes, so as the player moves on most queries are answered from the memo (see hintEngine.h).
+  A session is used by one thread at a time. */
+class HintSession {
+public:
+    explicit HintSession(const Deal& deal, size_t memoBytes = size_t(16) << 20);
+    ~HintSession();
+    HintSession(const HintSession&) = delete;
+    HintSession& operator=(const HintSession&) = delete;
+
+    // moves to the position after the moves played from the deal, returns false (and goes back to the deal) if one isn't legal
+    bool setPosition(Span<const Move> played);
+    // writes the winning moves from the position into moves (55 always fits) and returns how many there are
+    size_t winningMoves(Span<Move> moves);
+    // frees the memo, a later query starts an empty one
+    void end();
+
+private:
+    struct Session;
+    Session* session;
+};
+
+} // namespace gordons
+
+#endif
+
+#endif
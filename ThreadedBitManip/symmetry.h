@@ -0,0 +1,131 @@
+#pragma once
+
+/* Pile symmetry. Any two piles can be paired, so the rules don't care where a pile sits: two states whose piles are
+  a permutation of each other (only the ranks are stored, see card()) have the same future. Once piles start to empty
+  that happens a lot, one state has a lone 5 in pile 2 and another has it in pile 7, and solve() explores both.
+  CanonicalVisitedSet sorts the ten pile words before every visited lookup, so all the arrangements of the same piles
+  share one entry. The sort is the 29 comparator sorting network for 10 inputs, each comparator a min and a max, so
+  there are no data dependent branches.
+  To see what the merging buys, isSolvableCanonical can also run plain solve() on each deal and time both searches, so
+  the report shows the states and time with and without the symmetry. Otherwise it only reports the canonical search.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+
+#include "solver.h"
+
+// helper for one comparator of the network
+inline void compareSwap(uint32_t& a, uint32_t& b) {
+    uint32_t low = min(a, b);
+    b = max(a, b);
+    a = low;
+}
+
+// sorts the pile words in place with a 29 comparator, 8 layer network
+inline void sortPiles(uint32_t p[NUM_PILES]) {
+    static_assert(NUM_PILES == 10, "the network is for 10 piles");
+    compareSwap(p[0], p[8]); compareSwap(p[1], p[9]); compareSwap(p[2], p[7]); compareSwap(p[3], p[5]); compareSwap(p[4], p[6]);
+    compareSwap(p[0], p[2]); compareSwap(p[1], p[4]); compareSwap(p[5], p[8]); compareSwap(p[7], p[9]);
+    compareSwap(p[0], p[3]); compareSwap(p[2], p[4]); compareSwap(p[5], p[7]); compareSwap(p[6], p[9]);
+    compareSwap(p[0], p[1]); compareSwap(p[3], p[6]); compareSwap(p[8], p[9]);
+    compareSwap(p[1], p[5]); compareSwap(p[2], p[3]); compareSwap(p[4], p[8]); compareSwap(p[6], p[7]);
+    compareSwap(p[1], p[2]); compareSwap(p[3], p[5]); compareSwap(p[4], p[6]); compareSwap(p[7], p[8]);
+    compareSwap(p[2], p[3]); compareSwap(p[4], p[5]); compareSwap(p[6], p[7]);
+    compareSwap(p[3], p[4]); compareSwap(p[5], p[6]);
+}
+
+// the representative of a state's pile permutations: the same reserve, the piles in ascending order
+inline GameState canonicalState(const GameState& state) {
+    GameState canonical = state;
+    sortPiles(canonical.piles);
+    return canonical;
+}
+
+/* a visited set for solve() that treats states with the same piles in a different order as the same state.
+  solve() inserts the state it has just looked up, so find() keeps its canonical state for the insert */
+struct CanonicalVisitedSet {
+    unordered_set<GameState, GameStateHasher> states;
+    GameState lookedUp;
+    GameState lookedUpCanonical;
+    uint64_t canonicalizations = 0;
+
+    unordered_set<GameState, GameStateHasher>::const_iterator find(const GameState& state) {
+        lookedUp = state;
+        lookedUpCanonical = canonicalState(state);
+        canonicalizations++;
+        return states.find(lookedUpCanonical);
+    }
+    unordered_set<GameState, GameStateHasher>::const_iterator end() const {
+        return states.end();
+    }
+    void insert(const GameState& state) {
+        if (state == lookedUp) {
+            states.insert(lookedUpCanonical);
+        } else {
+            canonicalizations++;
+            states.insert(canonicalState(state));
+        }
+    }
+    size_t size() const {
+        return states.size();
+    }
+};
+
+// per thread and then summed, the plain solve() numbers are for the same deals and stay 0 unless compared
+struct CanonicalStats {
+    uint64_t states;              // distinct canonical states
+    uint64_t canonicalizations;   // canonicalState() calls, one per visited lookup
+    uint64_t canonicalNanos;
+    uint64_t baselineStates;      // states plain solve() visited
+    uint64_t baselineNanos;
+};
+
+// function which checks to see if a state is solvable with pile symmetry folded out of the visited set. compare searches
+// it again with plain solve() for the comparison in the report
+bool isSolvableCanonical(GameState* state, CanonicalStats& stats, bool compare = false) {
+    if (hasThreeJacks(state)) {
+        return false;
+    }
+    auto start = chrono::steady_clock::now();
+    CanonicalVisitedSet visited;
+    GameState active = *state;
+    bool solvable = solve(active, visited);
+    auto middle = chrono::steady_clock::now();
+    stats.states += visited.size();
+    stats.canonicalizations += visited.canonicalizations;
+    stats.canonicalNanos += chrono::duration_cast<chrono::nanoseconds>(middle - start).count();
+    if (compare) {
+        unordered_set<GameState, GameStateHasher> plain;
+        active = *state;
+        solve(active, plain);
+        stats.baselineStates += plain.size();
+        stats.baselineNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - middle).count();
+    }
+    return solvable;
+}
+
+void addCanonicalStats(CanonicalStats& into, const CanonicalStats& from) {
+    into.states += from.states;
+    into.canonicalizations += from.canonicalizations;
+    into.canonicalNanos += from.canonicalNanos;
+    into.baselineStates += from.baselineStates;
+    into.baselineNanos += from.baselineNanos;
+}
+
+// compared is whether the deals were also searched with plain solve()
+void printCanonicalStats(const CanonicalStats& stats, bool compared) {
+    if (!compared) {
+        cout << "States visited: " << stats.states << endl;
+        cout << "Canonicalizations: " << stats.canonicalizations << endl;
+        cout << "Search time: " << stats.canonicalNanos / 1000000 << " milliseconds (thread time)" << endl;
+        return;
+    }
+    double ratio = stats.states ? double(stats.baselineStates) / stats.states : 0.0;
+    cout << "States visited: " << stats.states << ", plain solve(): " << stats.baselineStates << " (" << ratio << "x)" << endl;
+    cout << "Canonicalizations: " << stats.canonicalizations << endl;
+    cout << "Search time: " << stats.canonicalNanos / 1000000 << " milliseconds, plain solve(): " << stats.baselineNanos / 1000000
+        << " milliseconds (thread time, the total includes both)" << endl;
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+/* Thread timeline tracing. Build with GAY_GORDONS_TRACE defined (cl /O2 /DGAY_GORDONS_TRACE main.cpp, or -DGAY_GORDONS_TRACE)
+  and each thread records spans into its own ring buffer: batches of deals, deals that take longer than TRACE_LONG_MICROS,
+  waits for contended locks and the phases of the run. TRACE_DUMP writes them out as a Chrome trace (JSON), which
+  chrome://tracing and ui.perfetto.dev open as one timeline row per thread.
+  Without GAY_GORDONS_TRACE every macro below expands to nothing (TRACED_LOCK to a plain lock_guard), so none of this is compiled.
+
+  Recording a span is two clock reads and a store into the thread's buffer, no locks. Only the first use on a thread
+  takes the registry lock to hand it a buffer. A full buffer overwrites its oldest spans and the dump says how many were lost.
+*/
+
+#ifdef GAY_GORDONS_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "print.h"
+
+// spans each thread keeps, 32 bytes each
+const size_t TRACE_RING_EVENTS = size_t(1) << 16;
+// deals per "batch" span
+const int TRACE_BATCH_DEALS = 1024;
+// deals that take at least this long get their own span
+const int64_t TRACE_LONG_MICROS = 10000;
+
+// one complete span. name must be a string literal (or otherwise outlive the dump)
+struct TraceEvent {
+    const char* name;
+    uint64_t start;    // nanoseconds since traceEpoch()
+    uint64_t duration;
+    int64_t arg;       // shown as the span's "value" argument, -1 for none
+};
+
+struct TraceBuffer {
+    vector<TraceEvent> events;
+    uint64_t written;      // spans ever recorded, the ring holds the last TRACE_RING_EVENTS of them
+    int tid;
+    string threadName;
+    uint64_t batchStart;   // start of the open batch span
+    int batchDeals;
+    bool batchOpen;
+};
+
+// the buffers of every thread that has traced, kept until the dump even if their threads have finished
+struct TraceRegistry {
+    mutex mtx;
+    vector<unique_ptr<TraceBuffer>> buffers;
+};
+
+inline TraceRegistry& traceRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline chrono::steady_clock::time_point traceEpoch() {
+    static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    return epoch;
+}
+
+inline uint64_t traceNow() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceEpoch()).count();
+}
+
+// the calling thread's buffer, registered on first use
+inline TraceBuffer& traceBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer) {
+        traceEpoch();
+        unique_ptr<TraceBuffer> created(new TraceBuffer());
+        created->events.resize(TRACE_RING_EVENTS);
+        created->written = 0;
+        created->batchOpen = false;
+        TraceRegistry& registry = traceRegistry();
+        lock_guard<mutex> lock(registry.mtx);
+        created->tid = static_cast<int>(registry.buffers.size());
+        created->threadName = "thread " + to_string(created->tid);
+        buffer = created.get();
+        registry.buffers.push_back(move(created));
+    }
+    return *buffer;
+}
+
+inline void traceRecord(const char* name, uint64_t start, uint64_t end, int64_t arg = -1) {
+    TraceBuffer& buffer = traceBuffer();
+    TraceEvent& event = buffer.events[buffer.written % TRACE_RING_EVENTS];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    event.arg = arg;
+    buffer.written++;
+}
+
+// a span from construction to destruction, recorded only if it lasted at least minNanos
+struct TraceSpan {
+    const char* name;
+    uint64_t start;
+    uint64_t minNanos;
+    int64_t arg;
+    explicit TraceSpan(const char* name, uint64_t minNanos = 0, int64_t arg = -1) : name(name), start(traceNow()), minNanos(minNanos), arg(arg) {}
+    ~TraceSpan() {
+        uint64_t end = traceNow();
+        if (end - start >= minNanos) traceRecord(name, start, end, arg);
+    }
+};
+
+// closes the thread's open batch span, its value is the number of deals in it
+inline void traceBatchEnd() {
+    TraceBuffer& buffer = traceBuffer();
+    if (!buffer.batchOpen) return;
+    traceRecord("batch", buffer.batchStart, traceNow(), buffer.batchDeals);
+    buffer.batchOpen = false;
+}
+
+// call before each deal of a thread's range: every TRACE_BATCH_DEALS deals the open batch span is closed and another opened
+inline void traceBatchDeal() {
+    TraceBuffer& buffer = traceBuffer();
+    if (buffer.batchOpen && buffer.batchDeals >= TRACE_BATCH_DEALS) {
+        traceBatchEnd();
+    }
+    if (!buffer.batchOpen) {
+        buffer.batchOpen = true;
+        buffer.batchStart = traceNow();
+        buffer.batchDeals = 0;
+    }
+    buffer.batchDeals++;
+}
+
+// locks mtx, recording a "lock wait" span if it was held by another thread
+inline unique_lock<mutex> traceLock(mutex& mtx) {
+    unique_lock<mutex> lock(mtx, try_to_lock);
+    if (!lock.owns_lock()) {
+        uint64_t start = traceNow();
+        lock.lock();
+        traceRecord("lock wait", start, traceNow());
+    }
+    return lock;
+}
+
+// helper to write a string as a JSON string (names are plain text, so only quotes and backslashes need escaping)
+inline void traceWriteString(FILE* file, const string& text) {
+    fputc('"', file);
+    for (char c : text) {
+        if (c == '"' || c == '\\') fputc('\\', file);
+        fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+// writes every thread's spans to path as a Chrome trace, returns false if the file can't be written
+inline bool traceDump(const char* path) {
+    traceBatchEnd();
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    TraceRegistry& registry = traceRegistry();
+    lock_guard<mutex> lock(registry.mtx);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    uint64_t lost = 0;
+    for (auto& buffer : registry.buffers) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", buffer->tid);
+        traceWriteString(file, buffer->threadName);
+        fprintf(file, "}}");
+        first = false;
+        uint64_t kept = buffer->written < TRACE_RING_EVENTS ? buffer->written : TRACE_RING_EVENTS;
+        lost += buffer->written - kept;
+        for (uint64_t i = buffer->written - kept; i < buffer->written; ++i) {
+            const TraceEvent& event = buffer->events[i % TRACE_RING_EVENTS];
+            fprintf(file, ",\n{\"name\":");
+            traceWriteString(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", buffer->tid, event.start / 1000.0, event.duration / 1000.0);
+            if (event.arg >= 0) fprintf(file, ",\"args\":{\"value\":%lld}", static_cast<long long>(event.arg));
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n],\"otherData\":{\"lostSpans\":%llu}}\n", static_cast<unsigned long long>(lost));
+    bool ok = !ferror(file);
+    ok &= fclose(file) == 0;
+    return ok;
+}
+
+inline void traceThreadName(const string& name) {
+    traceBuffer().threadName = name;
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// a span over the rest of the enclosing scope
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+// the same, but only recorded if it takes at least TRACE_LONG_MICROS, with value (e.g. the deal number) as its argument
+#define TRACE_LONG_SPAN(name, value) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, uint64_t(TRACE_LONG_MICROS) * 1000, int64_t(value))
+#define TRACE_BATCH_DEAL() traceBatchDeal()
+#define TRACE_BATCH_END() traceBatchEnd()
+#define TRACED_LOCK(lock, mtx) unique_lock<mutex> lock = traceLock(mtx)
+#define TRACE_THREAD_NAME(name) traceThreadName(name)
+#define TRACE_DUMP(path) traceDump(path)
+
+#else
+
+#define TRACE_SPAN(name)
+#define TRACE_LONG_SPAN(name, value)
+#define TRACE_BATCH_DEAL()
+#define TRACE_BATCH_END()
+#define TRACED_LOCK(lock, mtx) lock_guard<mutex> lock(mtx)
+#define TRACE_THREAD_NAME(name)
+#define TRACE_DUMP(path) true
+
+#endif
@@ -0,0 +1,123 @@
+#pragma once
+
+/* Worker threads kept for the life of the process, for the modes that put several threads on one piece of work
+  (one deal's search, a batch of deals). Starting threads for every deal costs more than most deals take, so a job is
+  handed to the pool instead and the calling thread works on it too. Idle workers sleep on a condition variable.
+  A job is work(helper), called for one turn at a time: a chunk of a batch, or a worker's whole share of a search.
+  It returns true while there is more to take. The caller's turns are work(0), a pool worker gets a helper number
+  from 1 to the job's maxHelpers that no other worker on the job has during its turn.
+  Several jobs can be open at once (the library takes batches from several threads). A worker that finishes a turn
+  moves on to the next open job after it, so a long job can't keep the workers from a short one that comes later.
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// helper numbers are bits of a 64 bit mask
+const int MAX_POOL_HELPERS = 64;
+
+class WorkerPool {
+public:
+    explicit WorkerPool(int numWorkers) : nextJob(0), stopping(false) {
+        for (int i = 0; i < numWorkers; ++i) {
+            workers.emplace_back(&WorkerPool::workerLoop, this);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    /* runs a job with up to maxHelpers pool workers on it besides the calling thread. Returns once the caller's
+      turns are done and no worker is still on one */
+    void run(const std::function<bool(int)>& work, int maxHelpers) {
+        Job job = { &work, std::min(std::min(maxHelpers, size()), MAX_POOL_HELPERS), 0, 0, true };
+        if (job.maxHelpers > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                jobs.push_back(&job);
+            }
+            wake.notify_all();
+        }
+        while (work(0)) {}
+        if (job.maxHelpers > 0) {
+            std::unique_lock<std::mutex> lock(mtx);
+            job.open = false;
+            finished.wait(lock, [&] { return job.active == 0; });
+            jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+        }
+    }
+
+private:
+    struct Job {
+        const std::function<bool(int)>* work;
+        int maxHelpers;
+        uint64_t busyHelpers; // bit h - 1 is set while helper h is on a turn
+        int active;
+        bool open;            // cleared once a turn returns false or the caller is done
+    };
+
+    // the next open job with a free helper number, round robin from the one after the last job taken. Under the mutex
+    Job* claim(int& helper) {
+        for (size_t k = 0; k < jobs.size(); ++k) {
+            size_t index = (nextJob + k) % jobs.size();
+            Job* job = jobs[index];
+            if (!job->open || job->active >= job->maxHelpers) continue;
+            helper = 1;
+            while (job->busyHelpers & (uint64_t(1) << (helper - 1))) helper++;
+            job->busyHelpers |= uint64_t(1) << (helper - 1);
+            job->active++;
+            nextJob = index + 1;
+            return job;
+        }
+        return nullptr;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        for (;;) {
+            Job* job = nullptr;
+            int helper = 0;
+            wake.wait(lock, [&] { return stopping || (job = claim(helper)) != nullptr; });
+            if (!job) return;
+            lock.unlock();
+            bool more = (*job->work)(helper);
+            lock.lock();
+            job->busyHelpers &= ~(uint64_t(1) << (helper - 1));
+            job->active--;
+            if (!more) job->open = false;
+            if (job->active == 0 && !job->open) finished.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::vector<Job*> jobs;
+    size_t nextJob;
+    bool stopping;
+};
+
+// the pool the solver headers share, started on first use with numThreads - 1 workers (the caller is the other thread)
+WorkerPool& sharedWorkerPool(int numThreads) {
+    static WorkerPool pool(std::max(numThreads, 1) - 1);
+    return pool;
+}